@@ -0,0 +1,395 @@
+/*
+***************************************
+*      - Reverse Cuthill McKee -      *
+*          Benchmark harness          *
+***************************************
+*/
+
+#include "rcm.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#define LIBRARY "openmp"
+#else
+#define LIBRARY "sequential"
+#endif
+
+#define MAX_VALUES 64
+
+//! A comma separated list of values given on the command line
+typedef struct List
+{
+    int count;
+    double values[MAX_VALUES];
+} List;
+
+//! Statistics of the samples of one point of the grid, in seconds
+typedef struct Sample
+{
+    const char *input;
+    const char *graph;
+    int n;
+    double density;
+    int threads;
+    int seed;
+    double median;
+    double p10;
+    double p90;
+    double min;
+    double max;
+    double mean;
+} Sample;
+
+void usage(const char *name);
+const char *engine_name(void);
+const char *backend_name(void);
+const char *start_name(void);
+void parse_list(const char *str, List *list);
+int *dense_matrix(CSR *A);
+double run_once(const char *input, int *X, CSR *A, int n);
+void summarize(double *times, int repetitions, Sample *S);
+double percentile(double *sorted, int count, double p);
+int compare_double(const void *a, const void *b);
+void write_csv(FILE *fp, Sample *samples, int count, int repetitions, int warmup);
+void write_json(FILE *fp, Sample *samples, int count, int repetitions, int warmup);
+
+int main(int argc, char *argv[])
+{
+    List sizes, densities, threads, seeds, inputs;
+    parse_list("1000,2000,4000", &sizes);
+    parse_list("1,5", &densities);
+    parse_list("1,2,4", &threads);
+    parse_list("1,2,3", &seeds);
+    inputs.count = 2; // dense and CSR
+    int repetitions = 5;
+    int warmup = 1;
+    char *output = NULL;
+
+    //! The start mode, the engine, the ordering and the backend are picked as in main()
+    char *start = getenv("RCM_START");
+    if (start != NULL && strcmp(start, "peripheral") == 0)
+        rcm_set_start_mode(RCM_START_PSEUDO_PERIPHERAL);
+
+    char *engine = getenv("RCM_ENGINE");
+    if (engine != NULL && strcmp(engine, "levels") == 0)
+        rcm_set_engine(RCM_ENGINE_LEVELS);
+    else if (engine != NULL && strcmp(engine, "components") == 0)
+        rcm_set_engine(RCM_ENGINE_COMPONENTS);
+
+    char *ordering = getenv("RCM_ORDERING");
+    if (ordering != NULL)
+    {
+        int o = rcm_ordering_from_name(ordering);
+        if (o < 0)
+        {
+            printf(RED "Error:" RESET_COLOR " Unknown ordering '%s'\n\n", ordering);
+            return 1;
+        }
+        rcm_set_ordering((RCMOrdering)o);
+    }
+
+    char *backend = getenv("RCM_BACKEND");
+    if (backend != NULL && strcmp(backend, "sequential") == 0)
+        rcm_set_backend(RCM_BACKEND_SEQUENTIAL);
+
+    //! And so is the family of the matrices
+    RCMGraph graph = RCM_GRAPH_RANDOM;
+    char *family = getenv("RCM_GRAPH");
+    if (family != NULL)
+    {
+        int g = rcm_graph_from_name(family);
+        if (g < 0)
+        {
+            printf(RED "Error:" RESET_COLOR " Unknown graph '%s'\n\n", family);
+            return 1;
+        }
+        graph = (RCMGraph)g;
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:t:s:i:r:w:o:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            parse_list(optarg, &sizes);
+            break;
+        case 'd':
+            parse_list(optarg, &densities);
+            break;
+        case 't':
+            parse_list(optarg, &threads);
+            break;
+        case 's':
+            parse_list(optarg, &seeds);
+            break;
+        case 'i':
+            //! dense, csr or both
+            inputs.count = (strcmp(optarg, "both") == 0) ? 2 : 1;
+            inputs.values[0] = (strcmp(optarg, "csr") == 0) ? 1 : 0;
+            break;
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if (inputs.count == 2)
+    {
+        inputs.values[0] = 0;
+        inputs.values[1] = 1;
+    }
+    if (repetitions < 1)
+        repetitions = 1;
+
+    //! The sequential library runs on one thread whatever is asked
+#ifndef _OPENMP
+    threads.count = 1;
+    threads.values[0] = 1;
+#endif
+
+    int total = sizes.count * densities.count * threads.count * seeds.count * inputs.count;
+    if (total == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Sample *samples = malloc(total * sizeof(Sample));
+    double *times = malloc(repetitions * sizeof(double));
+    if (samples == NULL || times == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for the samples failed\n\n");
+        exit(1);
+    }
+
+    int count = 0;
+    for (int a = 0; a < sizes.count; a++)
+        for (int b = 0; b < densities.count; b++)
+            for (int c = 0; c < seeds.count; c++)
+            {
+                int n = (int)sizes.values[a];
+                double density = densities.values[b];
+                int seed = (int)seeds.values[c];
+
+                //! The same matrix is used for every thread count and input
+                CSR *A = generate_graph(graph, n, density, seed);
+                if (A == NULL)
+                    exit(1);
+                n = A->n; // grids round it down
+                int *X = dense_matrix(A);
+
+                for (int d = 0; d < threads.count; d++)
+                {
+#ifdef _OPENMP
+                    omp_set_num_threads((int)threads.values[d]);
+#endif
+                    for (int e = 0; e < inputs.count; e++)
+                    {
+                        const char *input = (inputs.values[e] == 0) ? "dense" : "csr";
+
+                        for (int r = 0; r < warmup; r++)
+                            run_once(input, X, A, n);
+                        for (int r = 0; r < repetitions; r++)
+                            times[r] = run_once(input, X, A, n);
+
+                        Sample *S = &samples[count++];
+                        S->input = input;
+                        S->graph = rcm_graph_name(graph);
+                        S->n = n;
+                        S->density = density;
+                        S->threads = (int)threads.values[d];
+                        S->seed = seed;
+                        summarize(times, repetitions, S);
+
+                        fprintf(stderr, "%s %s %s n=%d density=%.2f threads=%d seed=%d: median %f sec\n",
+                                LIBRARY, input, S->graph, n, density, S->threads, seed, S->median);
+                    }
+                }
+
+                free(X);
+                freeCSR(A);
+            }
+
+    //! Write the results as JSON if the file name asks for it, else as CSV
+    FILE *fp = stdout;
+    if (output != NULL)
+    {
+        fp = fopen(output, "w");
+        if (fp == NULL)
+        {
+            printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", output);
+            return 1;
+        }
+    }
+
+    size_t len = (output != NULL) ? strlen(output) : 0;
+    if (len >= 5 && strcmp(output + len - 5, ".json") == 0)
+        write_json(fp, samples, count, repetitions, warmup);
+    else
+        write_csv(fp, samples, count, repetitions, warmup);
+
+    if (fp != stdout)
+        fclose(fp);
+
+    free(samples);
+    free(times);
+
+    return 0;
+}
+
+void usage(const char *name)
+{
+    printf("Usage: %s [-n sizes] [-d densities] [-t threads] [-s seeds]\n"
+           "          [-i dense|csr|both] [-r repetitions] [-w warmup] [-o file.csv|file.json]\n\n"
+           "Lists are comma separated, e.g. -n 1000,2000 -t 1,2,4\n",
+           name);
+}
+
+const char *engine_name(void)
+{
+#ifdef _OPENMP
+    if (rcm_get_engine() == RCM_ENGINE_LEVELS)
+        return "levels";
+    if (rcm_get_engine() == RCM_ENGINE_COMPONENTS)
+        return "components";
+#endif
+
+    return "queue";
+}
+
+const char *backend_name(void)
+{
+#ifdef _OPENMP
+    if (rcm_get_backend() == RCM_BACKEND_SEQUENTIAL)
+        return "sequential";
+#endif
+
+    return LIBRARY;
+}
+
+const char *start_name(void)
+{
+    return (rcm_get_start_mode() == RCM_START_PSEUDO_PERIPHERAL) ? "peripheral" : "min_degree";
+}
+
+void parse_list(const char *str, List *list)
+{
+    list->count = 0;
+
+    const char *p = str;
+    while (*p != '\0' && list->count < MAX_VALUES)
+    {
+        char *end;
+        double value = strtod(p, &end);
+        if (end == p)
+            break;
+
+        list->values[list->count++] = value;
+        p = (*end == ',') ? end + 1 : end;
+    }
+}
+
+//! The dense form of a generated matrix, as main() builds it
+int *dense_matrix(CSR *A)
+{
+    int *X = malloc((size_t)A->n * A->n * sizeof(int));
+    if (X == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for 'X' failed\n\n");
+        exit(1);
+    }
+
+    Graph G = {A->n, A->nnz, A->row_ptr, A->col_idx};
+    graph_to_dense(&G, X);
+
+    return X;
+}
+
+//! Time one reordering with a monotonic clock
+double run_once(const char *input, int *X, CSR *A, int n)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int *permutation = (strcmp(input, "dense") == 0) ? rcm(X, n) : rcm_csr(A->row_ptr, A->col_idx, n);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (permutation == NULL)
+        exit(1);
+    free(permutation);
+
+    return (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1.0e9;
+}
+
+void summarize(double *times, int repetitions, Sample *S)
+{
+    qsort(times, repetitions, sizeof(double), compare_double);
+
+    double sum = 0;
+    for (int r = 0; r < repetitions; r++)
+        sum += times[r];
+
+    S->median = percentile(times, repetitions, 50);
+    S->p10 = percentile(times, repetitions, 10);
+    S->p90 = percentile(times, repetitions, 90);
+    S->min = times[0];
+    S->max = times[repetitions - 1];
+    S->mean = sum / repetitions;
+}
+
+//! Percentile p of sorted samples, interpolating between the closest ranks
+double percentile(double *sorted, int count, double p)
+{
+    double rank = p / 100 * (count - 1);
+    int below = (int)rank;
+    if (below >= count - 1)
+        return sorted[count - 1];
+
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+void write_csv(FILE *fp, Sample *samples, int count, int repetitions, int warmup)
+{
+    fprintf(fp, "library,backend,ordering,kernels,engine,start,input,graph,n,density,threads,seed,repetitions,warmup,median,p10,p90,min,max,mean\n");
+    for (int k = 0; k < count; k++)
+    {
+        Sample *S = &samples[k];
+        fprintf(fp, "%s,%s,%s,%s,%s,%s,%s,%s,%d,%g,%d,%d,%d,%d,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f\n",
+                LIBRARY, backend_name(), rcm_ordering_name(rcm_get_ordering()), row_kernels_name(), engine_name(), start_name(), S->input, S->graph, S->n, S->density, S->threads, S->seed,
+                repetitions, warmup, S->median, S->p10, S->p90, S->min, S->max, S->mean);
+    }
+}
+
+void write_json(FILE *fp, Sample *samples, int count, int repetitions, int warmup)
+{
+    fprintf(fp, "{\n  \"library\": \"%s\",\n  \"backend\": \"%s\",\n", LIBRARY, backend_name());
+    fprintf(fp, "  \"ordering\": \"%s\",\n  \"kernels\": \"%s\",\n", rcm_ordering_name(rcm_get_ordering()), row_kernels_name());
+    fprintf(fp, "  \"engine\": \"%s\",\n  \"start\": \"%s\",\n", engine_name(), start_name());
+    fprintf(fp, "  \"repetitions\": %d,\n  \"warmup\": %d,\n  \"results\": [\n", repetitions, warmup);
+    for (int k = 0; k < count; k++)
+    {
+        Sample *S = &samples[k];
+        fprintf(fp, "    {\"input\": \"%s\", \"graph\": \"%s\", \"n\": %d, \"density\": %g, \"threads\": %d, \"seed\": %d, "
+                    "\"median\": %.9f, \"p10\": %.9f, \"p90\": %.9f, \"min\": %.9f, \"max\": %.9f, \"mean\": %.9f}%s\n",
+                S->input, S->graph, S->n, S->density, S->threads, S->seed,
+                S->median, S->p10, S->p90, S->min, S->max, S->mean, (k < count - 1) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+}
@@ -11,11 +11,90 @@
 struct timeval startwtime, endwtime;
 double p_time;
 
+int reorder_file(int argc, char *argv[]);
+int reorder_bitmatrix(BitMatrix *B, double load_time, int argc, char *argv[]);
+void free_input(CSR *A, MappedMatrix *M);
+int reorder_batch(int argc, char *argv[]);
+char **read_names(FILE *fp, int *count);
+int calibrate(const char *filename);
+int is_number(const char *str);
+int ends_with(const char *str, const char *suffix);
+void print_metrics(const char *which, Metrics *M);
+void print_stats(RCMStats *S);
+
+//! Where the time goes inside rcm(), if RCM_STATS is set
+RCMStats *stats = NULL;
+
 int main(int argc, char *argv[])
 {
     int n;
     double density;
 
+    //! Start every component from a pseudo-peripheral node
+    //! instead of a node of minimum degree, if asked to
+    char *start = getenv("RCM_START");
+    if (start != NULL && strcmp(start, "peripheral") == 0)
+        rcm_set_start_mode(RCM_START_PSEUDO_PERIPHERAL);
+
+    //! Traverse a whole BFS level at a time, or all
+    //! connected components at once, if asked to
+    char *engine = getenv("RCM_ENGINE");
+    if (engine != NULL && strcmp(engine, "levels") == 0)
+        rcm_set_engine(RCM_ENGINE_LEVELS);
+    else if (engine != NULL && strcmp(engine, "components") == 0)
+        rcm_set_engine(RCM_ENGINE_COMPONENTS);
+
+    //! Compute another ordering than RCM, if asked to
+    char *ordering = getenv("RCM_ORDERING");
+    if (ordering != NULL)
+    {
+        int o = rcm_ordering_from_name(ordering);
+        if (o < 0)
+        {
+            printf(RED "Error:" RESET_COLOR " Unknown ordering '%s' (rcm, cm, sloan or gps)\n\n", ordering);
+            return 1;
+        }
+        rcm_set_ordering((RCMOrdering)o);
+    }
+
+    //! Run the sequential implementation the OpenMP library
+    //! also holds, if asked to
+    char *backend = getenv("RCM_BACKEND");
+    if (backend != NULL && strcmp(backend, "sequential") == 0)
+        rcm_set_backend(RCM_BACKEND_SEQUENTIAL);
+
+    //! Use the thresholds of the file RCM_TUNING names, or
+    //! of rcm.tuning if there is one in the current directory
+    char *tuning = getenv("RCM_TUNING");
+    if (tuning != NULL || access("rcm.tuning", R_OK) == 0)
+        if (rcm_load_tuning(tuning != NULL ? tuning : "rcm.tuning") != 0)
+            return 1;
+
+    //! Time the parallel phases on this host and save their best
+    //! thresholds and threads, to rcm.tuning unless a file is given
+    if (argc > 1 && strcmp(argv[1], "--calibrate") == 0)
+        return calibrate(argc > 2 ? argv[2] : "rcm.tuning");
+
+    //! Reorder many matrix files, each one on a thread of its own
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+        return reorder_batch(argc, argv);
+
+    //! Collect where the time goes inside rcm, if asked to
+    if (getenv("RCM_STATS") != NULL)
+    {
+        stats = malloc(sizeof(RCMStats));
+        if (stats == NULL)
+        {
+            printf(RED "Error:" RESET_COLOR " Memory allocation for 'stats' failed\n\n");
+            exit(1);
+        }
+    }
+
+    //! If the first argument is not a number, then it is a matrix file
+    //! (Matrix Market, binary CSR or bit-packed) which is loaded and reordered
+    if (argc > 1 && !is_number(argv[1]))
+        return reorder_file(argc, argv);
+
     if (argc > 2)
     {
         n = atoi(argv[1]);       // # size of matrix (n*n)
@@ -27,62 +106,69 @@ int main(int argc, char *argv[])
         density = 1; // default value for density
     }
 
-    printf(YELLOW "\nn: " RESET_COLOR "%d" YELLOW "\ndensity: " RESET_COLOR "%.2f %%\n\n", n, density);
+    //! The family of the matrix, random unless RCM_GRAPH names
+    //! another one, and its seed, from the clock unless RCM_SEED is set
+    RCMGraph graph = RCM_GRAPH_RANDOM;
+    char *family = getenv("RCM_GRAPH");
+    if (family != NULL)
+    {
+        int g = rcm_graph_from_name(family);
+        if (g < 0)
+        {
+            printf(RED "Error:" RESET_COLOR " Unknown graph '%s' (random, grid2d, grid3d, banded or powerlaw)\n\n", family);
+            return 1;
+        }
+        graph = (RCMGraph)g;
+    }
+
+    char *seed_str = getenv("RCM_SEED");
+    uint64_t seed = (seed_str != NULL) ? strtoull(seed_str, NULL, 10) : (uint64_t)time(0);
 
-    //! Create a random symmetric matrix with given size
-    //! and density. Diagonial row consists of zeros
-    int *X = malloc(n * n * sizeof(int));
+    //! Create a symmetric matrix of the family with given size and
+    //! density, straight to CSR, and expand it to a dense one
+    CSR *A = generate_graph(graph, n, density, seed);
+    if (A == NULL)
+        return 1;
+    n = A->n; // grids round it down
+
+    int *X = malloc((size_t)n * n * sizeof(int));
     if (X == NULL)
     {
         printf(RED "Error:" RESET_COLOR " Memory allocation for 'X' failed\n\n");
         exit(1);
     }
 
-    srand(time(0));
-    for (int i = 0; i < n; i++)
-    {
-        for (int j = i; j < n; j++)
-        {
-            if (i == j)
-                X[n * i + j] = 1;
-            else
-            {
-                double bin = (double)rand() / RAND_MAX;
-                if (bin <= 0.01 * density)
-                    X[n * i + j] = 1;
-                else
-                    X[n * i + j] = 0;
-            }
-        }
+    Graph G = {n, A->nnz, A->row_ptr, A->col_idx};
+    graph_to_dense(&G, X);
+    freeCSR(A);
 
-        for (int j = 0; j < i; j++)
-            X[n * i + j] = X[n * j + i];
-    }
+    printf(YELLOW "\nn: " RESET_COLOR "%d" YELLOW "\ndensity: " RESET_COLOR "%.2f %%", n, density);
+    printf(YELLOW "\ngraph: " RESET_COLOR "%s" YELLOW "\nseed: " RESET_COLOR "%llu\n\n", rcm_graph_name(graph),
+           (unsigned long long)seed);
 
-    //! Create array to store the permutation
-    int *permutation = malloc(n * sizeof(int));
-    if (permutation == NULL)
-    {
-        printf(RED "Error:" RESET_COLOR " Memory allocation for 'permutation' failed\n\n");
-        exit(1);
-    }
+    //! The permutation, returned by rcm
+    int *permutation = NULL;
 
     //! If maximum two arguments were given, then the program will just
     //! calculate the permutation and print the time elapsed.
     //! If a third argument was given, then the program will also calculate
-    //! input and output bandwidth, and will store the input and
-    //! output matrices in csv files, using the argument as name
+    //! input and output bandwidth, and will store the input and output
+    //! matrices and the permutation in files, using the argument as name.
+    //! Its extension picks the format (.mtx, .csv, or binary CSR)
     if (argc <= 3)
     {
         //! ========= START POINT =========
         gettimeofday(&startwtime, NULL);
 
         //! Implement RCM Algorithm
-        permutation = rcm(X, n);
+        permutation = rcm_stats(X, n, stats);
 
         //! ========= END POINT =========
         gettimeofday(&endwtime, NULL);
         p_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+        if (permutation == NULL)
+            return 1;
     }
     else
     {
@@ -94,143 +180,547 @@ int main(int argc, char *argv[])
         }
 
         //! Create the input graph according to input matrix
-        Graph *inp_graph = createGraph(n);
-        for (int i = 0; i < n; i++)
-            for (int j = i + 1; j < n; j++)
-                if (X[n * i + j])
-                    addEdge(inp_graph, i, j);
+        Graph *inp_graph = dense_to_graph(X, n);
+        if (inp_graph == NULL)
+            return 1;
 
-        //! Calculate input bandwidth
-        int bandwidth_inp = calc_bandwidth(X, n);
-        printf(YELLOW "Input bandwidth: " RESET_COLOR "%d\n\n", bandwidth_inp);
+        //! Calculate input bandwidth, profile and wavefront
+        Metrics metrics_inp;
+        if (calc_metrics_csr(inp_graph->offsets, inp_graph->adjacency, n, NULL, &metrics_inp) != 0)
+            return 1;
+        print_metrics("Input", &metrics_inp);
 
         //! ***** UNCOMMENT to print the input graph
         // printf(YELLOW "--- Input Graph ---\n" RESET_COLOR);
         // printGraph(inp_graph);
 
-        //! Write input matrix to a file
+        //! Write input matrix to a file, in the format its name asks for
+        gettimeofday(&startwtime, NULL);
+
         char filename1[100] = {0};
         snprintf(filename1, sizeof(filename1), "matrices/input_%s", argv[3]);
-        FILE *fp1;
-        fp1 = fopen(filename1, "w");
-        if (fp1 == NULL)
-        {
-            printf("Error while opening the file.\n");
-            return 0;
-        }
-        for (int i = 0; i < n; i++)
-        {
-            for (int j = 0; j < n; j++)
-            {
-                fprintf(fp1, "%d", X[n * i + j]);
-                if (j < n - 1)
-                    fprintf(fp1, ",");
-            }
-            fprintf(fp1, "\n");
-        }
-        fclose(fp1);
+        CSR inp_csr = {n, inp_graph->numEdges, inp_graph->offsets, inp_graph->adjacency};
+        if (write_matrix(filename1, &inp_csr) != 0)
+            return 1;
+
+        gettimeofday(&endwtime, NULL);
+        double write_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
 
         //! ========= START POINT =========
         gettimeofday(&startwtime, NULL);
 
         //! Implement RCM Algorithm
-        permutation = rcm(X, n);
+        permutation = rcm_stats(X, n, stats);
 
         //! ========= END POINT =========
         gettimeofday(&endwtime, NULL);
         p_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
 
+        if (permutation == NULL)
+            return 1;
+
         //! ***** UNCOMMENT to print the permutation array
         // printf(GREEN "Permutation: " RESET_COLOR);
         // print_array(permutation, n);
 
-        //! Store permutation array depending on indices
-        int *changes = malloc(n * sizeof(int));
-        if (permutation == NULL)
-        {
-            printf(RED "Error:" RESET_COLOR " Memory allocation for 'changes' failed\n\n");
-            exit(1);
-        }
-        for (int i = 0; i < n; i++)
-            changes[permutation[i]] = i;
-
-        //! Create the output graph
-        Graph *out_graph = createGraph(n);
-        for (int i = 0; i < n; i++)
-        {
-            struct node *temp = inp_graph->adjLists[permutation[i]];
-            while (temp)
-            {
-                addEdge(out_graph, i, changes[temp->vertex]);
-                temp = temp->next;
-            }
-        }
+        //! Create the output graph, whose vertex i
+        //! is vertex permutation[i] of the input graph
+        Graph *out_graph = permute_graph(inp_graph, permutation);
+        if (out_graph == NULL)
+            return 1;
 
         //! ***** UNCOMMENT to print the output graph
         // printf(YELLOW "--- Output Graph ---\n" RESET_COLOR);
         // printGraph(out_graph);
 
-        //! Create output matrix and initialize it with zeros
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < n; j++)
-                if (i == j)
-                    X[n * i + j] = 1;
-                else
-                    X[n * i + j] = 0;
-
-        //! Build the output matrix according to output graph
-        for (int v = 0; v < out_graph->numVertices; v++)
-        {
-            struct node *temp = out_graph->adjLists[v];
-            while (temp)
-            {
-                X[n * v + temp->vertex] = 1;
-                temp = temp->next;
-            }
-        }
-
         //! ***** Print the output matrix if n<=50
         if (n <= 50)
         {
+            graph_to_dense(out_graph, X);
             printf(YELLOW "=== Output Matrix ===\n" RESET_COLOR);
             print_array_2d(X, n);
         }
 
-        //! Calculate output bandwidth
-        int bandwidth_out = calc_bandwidth(X, n);
-        printf(YELLOW "Output bandwidth: " RESET_COLOR "%d\n\n", bandwidth_out);
+        //! Calculate output bandwidth, profile and wavefront
+        //! straight from the input graph and the permutation
+        Metrics metrics_out;
+        if (calc_metrics_csr(inp_graph->offsets, inp_graph->adjacency, n, permutation, &metrics_out) != 0)
+            return 1;
+        print_metrics("Output", &metrics_out);
+
+        //! Write output matrix and the permutation to files
+        gettimeofday(&startwtime, NULL);
 
-        //! Write output matrix to a file
         char filename2[100] = {0};
         snprintf(filename2, sizeof(filename2), "matrices/output_%s", argv[3]);
-        FILE *fp2;
-        fp2 = fopen(filename2, "w");
-        if (fp2 == NULL)
+        CSR out_csr = {n, out_graph->numEdges, out_graph->offsets, out_graph->adjacency};
+        if (write_matrix(filename2, &out_csr) != 0)
+            return 1;
+
+        char filename3[100] = {0};
+        snprintf(filename3, sizeof(filename3), "matrices/permutation_%s.perm", argv[3]);
+        if (write_permutation(filename3, permutation, n) != 0)
+            return 1;
+
+        gettimeofday(&endwtime, NULL);
+        write_time += (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+        printf("Write time: " RED "%f sec\n" RESET_COLOR, write_time);
+
+        freeGraph(inp_graph);
+        freeGraph(out_graph);
+    }
+
+    //! Print time elapsed
+    printf("Time elapsed: " RED "%f sec\n" RESET_COLOR, p_time);
+    if (stats != NULL)
+        print_stats(stats);
+
+    //! Free allocated memory
+    free(X);
+    free(permutation);
+    free(stats);
+
+    return 0;
+}
+
+/*
+*************************************************************************
+*    Load a matrix from a file straight to CSR and reorder it.          *
+*    Files ending in .mtx are read as Matrix Market, anything else      *
+*    as binary CSR. If a second argument is given (and is not "-"),     *
+*    the loaded matrix is also stored there in binary CSR, for fast     *
+*    reloads. If a third is given, the reordered matrix is stored there *
+*    (in the format its extension asks for) and the permutation next    *
+*    to it, with ".perm" appended to the name                           *
+*************************************************************************
+*/
+
+int reorder_file(int argc, char *argv[])
+{
+    char *filename = argv[1];
+
+    //! Load the matrix
+    gettimeofday(&startwtime, NULL);
+
+    //! Binary files are mapped instead, so that only what the
+    //! reordering touches is ever read, on huge pages if asked to
+    CSR *A = NULL;
+    MappedMatrix *M = NULL;
+    if (ends_with(filename, ".mtx"))
+        A = read_mtx(filename);
+    else if ((M = map_matrix(filename, getenv("RCM_HUGE_PAGES") != NULL ? RCM_MAP_HUGE_PAGES : 0)) != NULL)
+        A = &M->csr;
+    if (A == NULL)
+        return 1;
+
+    gettimeofday(&endwtime, NULL);
+    double load_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+    if (M != NULL && M->is_bitmatrix)
+    {
+        int status = reorder_bitmatrix(&M->bitmatrix, load_time, argc, argv);
+        unmap_matrix(M);
+        return status;
+    }
+
+    printf(YELLOW "\nfile: " RESET_COLOR "%s" YELLOW "\nn: " RESET_COLOR "%d" YELLOW "\nnnz: " RESET_COLOR "%lld\n\n",
+           filename, A->n, (long long)A->nnz);
+    printf("Load time: " RED "%f sec\n" RESET_COLOR, load_time);
+
+    //! Store it in binary CSR format
+    if (argc > 2 && strcmp(argv[2], "-") != 0)
+    {
+        if (write_csr_binary(argv[2], A) != 0)
         {
-            printf("Error while opening the file.\n");
-            return 0;
+            free_input(A, M);
+            return 1;
         }
-        for (int i = 0; i < n; i++)
+        printf(YELLOW "Binary CSR written to: " RESET_COLOR "%s\n", argv[2]);
+    }
+
+    //! ========= START POINT =========
+    gettimeofday(&startwtime, NULL);
+
+    //! Implement RCM Algorithm
+    int *permutation = rcm_csr_stats(A->row_ptr, A->col_idx, A->n, stats);
+
+    //! ========= END POINT =========
+    gettimeofday(&endwtime, NULL);
+    p_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+    if (permutation == NULL)
+    {
+        free_input(A, M);
+        return 1;
+    }
+
+    //! Print time elapsed
+    printf("Time elapsed: " RED "%f sec\n" RESET_COLOR, p_time);
+    if (stats != NULL)
+        print_stats(stats);
+
+    //! Compare the matrix before and after, without building the reordered one
+    Metrics metrics;
+    printf("\n");
+    if (calc_metrics_csr(A->row_ptr, A->col_idx, A->n, NULL, &metrics) == 0)
+        print_metrics("Input", &metrics);
+    if (calc_metrics_csr(A->row_ptr, A->col_idx, A->n, permutation, &metrics) == 0)
+        print_metrics("Output", &metrics);
+
+    //! Apply the permutation to the matrix (P A P')
+    gettimeofday(&startwtime, NULL);
+
+    CSR *B = permute_csr(A, permutation, 1);
+    if (B == NULL)
+    {
+        free_input(A, M);
+        free(permutation);
+        return 1;
+    }
+
+    gettimeofday(&endwtime, NULL);
+    double permute_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+    printf("Permute time: " RED "%f sec\n" RESET_COLOR, permute_time);
+
+    //! Store the reordered matrix and the permutation
+    if (argc > 3)
+    {
+        gettimeofday(&startwtime, NULL);
+
+        char perm_filename[256] = {0};
+        snprintf(perm_filename, sizeof(perm_filename), "%s.perm", argv[3]);
+        if (write_matrix(argv[3], B) != 0 || write_permutation(perm_filename, permutation, A->n) != 0)
         {
-            for (int j = 0; j < n; j++)
+            free_input(A, M);
+            freeCSR(B);
+            free(permutation);
+            return 1;
+        }
+
+        gettimeofday(&endwtime, NULL);
+        double write_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+        printf(YELLOW "Reordered matrix written to: " RESET_COLOR "%s\n", argv[3]);
+        printf("Write time: " RED "%f sec\n" RESET_COLOR, write_time);
+    }
+
+    //! Free allocated memory
+    free_input(A, M);
+    freeCSR(B);
+    free(permutation);
+    free(stats);
+
+    return 0;
+}
+
+//! Reorder a bit-packed matrix file. There are no metrics or
+//! reordered matrix for those, only the permutation is stored
+int reorder_bitmatrix(BitMatrix *B, double load_time, int argc, char *argv[])
+{
+    printf(YELLOW "\nfile: " RESET_COLOR "%s" YELLOW "\nn: " RESET_COLOR "%d (bit-packed)\n\n", argv[1], B->n);
+    printf("Load time: " RED "%f sec\n" RESET_COLOR, load_time);
+
+    //! ========= START POINT =========
+    gettimeofday(&startwtime, NULL);
+
+    //! Implement RCM Algorithm
+    int *permutation = rcm_bitset_stats(B, stats);
+
+    //! ========= END POINT =========
+    gettimeofday(&endwtime, NULL);
+    p_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+    if (permutation == NULL)
+        return 1;
+
+    //! Print time elapsed
+    printf("Time elapsed: " RED "%f sec\n" RESET_COLOR, p_time);
+    if (stats != NULL)
+        print_stats(stats);
+
+    //! Store the permutation
+    int status = 0;
+    if (argc > 3)
+    {
+        char perm_filename[256] = {0};
+        snprintf(perm_filename, sizeof(perm_filename), "%s.perm", argv[3]);
+        status = write_permutation(perm_filename, permutation, B->n);
+        if (status == 0)
+            printf(YELLOW "Permutation written to: " RESET_COLOR "%s\n", perm_filename);
+    }
+
+    free(permutation);
+    free(stats);
+
+    return (status == 0) ? 0 : 1;
+}
+
+//! Free a matrix that was either read or mapped
+void free_input(CSR *A, MappedMatrix *M)
+{
+    if (M != NULL)
+        unmap_matrix(M);
+    else
+        freeCSR(A);
+}
+
+/*
+*************************************************************************
+*    Load many matrix files, reorder them all with rcm_csr_batch()      *
+*    and report the throughput. The files are given after --batch, or   *
+*    one per line of the standard input if "-" is given instead. With   *
+*    -w, the permutation of every file is stored next to it, with       *
+*    ".perm" appended to the name                                       *
+*************************************************************************
+*/
+
+int reorder_batch(int argc, char *argv[])
+{
+    int first = 2;
+    int write = 0;
+    if (argc > first && strcmp(argv[first], "-w") == 0)
+    {
+        write = 1;
+        first++;
+    }
+
+    int count = argc - first;
+    char **names = argv + first;
+    char **lines = NULL;
+    if (count == 1 && strcmp(names[0], "-") == 0)
+    {
+        lines = read_names(stdin, &count);
+        names = lines;
+    }
+
+    if (count == 0)
+    {
+        printf("Usage: %s --batch [-w] file... (or - to read the names from stdin)\n", argv[0]);
+        free(lines);
+        return 1;
+    }
+
+    CSR **matrices = calloc(count, sizeof(CSR *));
+    int **permutations = calloc(count, sizeof(int *));
+    RCMStatus *status = malloc(count * sizeof(RCMStatus));
+    if (matrices == NULL || permutations == NULL || status == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for the batch failed\n\n");
+        exit(1);
+    }
+
+    //! Load all the files, one per thread
+    gettimeofday(&startwtime, NULL);
+
+    int failed = read_matrices(names, count, matrices);
+
+    gettimeofday(&endwtime, NULL);
+    double load_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+    long long nnz = 0;
+    for (int k = 0; k < count; k++)
+        if (matrices[k] != NULL)
+        {
+            nnz += matrices[k]->nnz;
+            permutations[k] = malloc((matrices[k]->n > 0 ? matrices[k]->n : 1) * sizeof(int));
+            if (permutations[k] == NULL)
             {
-                fprintf(fp2, "%d", X[n * i + j]);
-                if (j < n - 1)
-                    fprintf(fp2, ",");
+                printf(RED "Error:" RESET_COLOR " Memory allocation for 'permutation' failed\n\n");
+                exit(1);
             }
-            fprintf(fp2, "\n");
         }
-        fclose(fp2);
 
-        free(changes);
+    //! ========= START POINT =========
+    gettimeofday(&startwtime, NULL);
+
+    //! Implement RCM Algorithm on all of them
+    rcm_csr_batch(matrices, count, permutations, status);
+
+    //! ========= END POINT =========
+    gettimeofday(&endwtime, NULL);
+    p_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+    //! Report the matrices that could not be reordered (those that could
+    //! not be loaded have been reported already), and store the others
+    gettimeofday(&startwtime, NULL);
+
+    for (int k = 0; k < count; k++)
+    {
+        if (matrices[k] == NULL)
+            continue;
+
+        if (status[k] != RCM_OK)
+        {
+            printf(RED "Error:" RESET_COLOR " Reordering '%s' failed: %s\n\n", names[k], rcm_status_string(status[k]));
+            failed++;
+        }
+        else if (write)
+        {
+            char perm_filename[4096] = {0};
+            snprintf(perm_filename, sizeof(perm_filename), "%s.perm", names[k]);
+            if (write_permutation(perm_filename, permutations[k], matrices[k]->n) != 0)
+                failed++;
+        }
     }
 
-    //! Print time elapsed
+    gettimeofday(&endwtime, NULL);
+    double write_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+
+    printf(YELLOW "\nfiles: " RESET_COLOR "%d" YELLOW "\nfailed: " RESET_COLOR "%d" YELLOW "\nnnz: " RESET_COLOR "%lld\n\n",
+           count, failed, nnz);
+    printf("Load time: " RED "%f sec\n" RESET_COLOR, load_time);
     printf("Time elapsed: " RED "%f sec\n" RESET_COLOR, p_time);
+    if (write)
+        printf("Write time: " RED "%f sec\n" RESET_COLOR, write_time);
+    printf("Throughput: " RED "%.1f matrices/sec\n" RESET_COLOR, (p_time > 0) ? (count - failed) / p_time : 0);
 
     //! Free allocated memory
-    free(X);
-    free(permutation);
+    for (int k = 0; k < count; k++)
+    {
+        freeCSR(matrices[k]);
+        free(permutations[k]);
+        if (lines != NULL)
+            free(lines[k]);
+    }
+    free(matrices);
+    free(permutations);
+    free(status);
+    free(lines);
+
+    return (failed > 0) ? 1 : 0;
+}
+
+//! The non-empty lines of a file, without their newlines
+char **read_names(FILE *fp, int *count)
+{
+    int capacity = 64;
+    char **names = malloc(capacity * sizeof(char *));
+    if (names == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for the file names failed\n\n");
+        exit(1);
+    }
+
+    *count = 0;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while ((length = getline(&line, &size, fp)) != -1)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        if (length == 0)
+            continue;
+
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            names = realloc(names, capacity * sizeof(char *));
+        }
+        if (names == NULL || (names[*count] = strdup(line)) == NULL)
+        {
+            printf(RED "Error:" RESET_COLOR " Memory allocation for the file names failed\n\n");
+            exit(1);
+        }
+        (*count)++;
+    }
+    free(line);
+
+    return names;
+}
+
+int calibrate(const char *filename)
+{
+    RCMTuning T;
+
+    gettimeofday(&startwtime, NULL);
+    rcm_calibrate(&T);
+    gettimeofday(&endwtime, NULL);
+
+    p_time = (double)((endwtime.tv_usec - startwtime.tv_usec) / 1.0e6 + endwtime.tv_sec - startwtime.tv_sec);
+    printf(YELLOW "\nCalibration time: " RESET_COLOR "%f sec\n\n", p_time);
+
+    printf(YELLOW "%-8s %12s %8s\n" RESET_COLOR, "phase", "threshold", "threads");
+    printf("%-8s %12d %8d\n", "loop", T.loop_threshold, T.loop_threads);
+    printf("%-8s %12d %8d\n", "gather", T.gather_threshold, T.gather_threads);
+    printf("%-8s %12d %8d\n", "sort", T.sort_threshold, T.sort_threads);
+    printf("%-8s %12d %8d\n\n", "level", T.level_threshold, T.level_threads);
+
+    if (rcm_save_tuning(filename, &T) != 0)
+        return 1;
+    printf(GREEN_BOLD "Saved to %s\n\n" RESET_COLOR, filename);
 
     return 0;
-}
\ No newline at end of file
+}
+
+int is_number(const char *str)
+{
+    char *end;
+    strtod(str, &end);
+
+    return end != str && *end == '\0';
+}
+
+int ends_with(const char *str, const char *suffix)
+{
+    size_t len = strlen(str);
+    size_t suffix_len = strlen(suffix);
+
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+void print_metrics(const char *which, Metrics *M)
+{
+    printf(YELLOW "%s bandwidth: " RESET_COLOR "%d\n", which, M->bandwidth);
+    printf(YELLOW "%s profile: " RESET_COLOR "%lld\n", which, M->profile);
+    printf(YELLOW "%s wavefront: " RESET_COLOR "mean %.2f, rms %.2f, max %d\n\n",
+           which, M->mean_wavefront, M->rms_wavefront, M->max_wavefront);
+}
+
+void print_stats(RCMStats *S)
+{
+    printf(YELLOW "\n%-8s %12s %12s %7s\n" RESET_COLOR, "phase", "time (sec)", "calls", "share");
+    for (int p = 0; p < RCM_NUM_PHASES; p++)
+    {
+        double time = 0;
+        long long calls = 0;
+        for (int t = 0; t < S->threads; t++)
+        {
+            time += S->time[t][p];
+            calls += S->calls[t][p];
+        }
+
+        printf("%-8s %12f %12lld %6.1f%%\n", rcm_phase_name(p), time, calls,
+               (S->total_time > 0) ? 100 * time / S->total_time : 0);
+    }
+    printf("%-8s %12f\n", "total", S->total_time);
+
+    //! Per thread, only if more than one took part
+    if (S->threads > 1)
+    {
+        printf(YELLOW "\n%-8s" RESET_COLOR, "thread");
+        for (int p = 0; p < RCM_NUM_PHASES; p++)
+            printf(YELLOW " %10s" RESET_COLOR, rcm_phase_name(p));
+        printf("\n");
+
+        for (int t = 0; t < S->threads; t++)
+        {
+            printf("%-8d", t);
+            for (int p = 0; p < RCM_NUM_PHASES; p++)
+                printf(" %10f", S->time[t][p]);
+            printf("\n");
+        }
+    }
+
+    printf(YELLOW "\nOpenMP regions: " RESET_COLOR "%lld, %f sec\n", S->regions, S->region_time);
+
+    printf(YELLOW "Neighbor lists by size:\n" RESET_COLOR);
+    for (int b = 0; b < RCM_STATS_BINS; b++)
+        if (S->neighbors[b])
+        {
+            if (b == 0)
+                printf("%12s: %lld\n", "0", S->neighbors[b]);
+            else
+                printf("%5d-%-6d: %lld\n", 1 << (b - 1), (1 << b) - 1, S->neighbors[b]);
+        }
+    printf("\n");
+}
@@ -8,7 +8,7 @@
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 size = 3;
-arg = 'seq'; % This must be the same as the third argument when running the program
+arg = 'seq.csv'; % This must be the same as the third argument when running the program (ending in .csv)
 
 %% Read the input matrix
 figure;
@@ -8,6 +8,7 @@
 #include <math.h>
 #include <float.h>
 #include <time.h>
+#include <stdint.h>
 
 #include <sys/time.h>
 #include <sys/times.h>
@@ -19,6 +20,28 @@
 #define YELLOW "\033[0;33m"
 #define RESET_COLOR "\033[0m"
 
+/*
+*************************************************************************
+*    --- Index types ---                                                *
+*                                                                       *
+*    Nodes (n, column indices and permutations) are always ints. Row    *
+*    pointers and counts of stored entries are RCMOffset: an int by     *
+*    default, which keeps them as compact as the column indices, or a   *
+*    64-bit integer for matrices of more than 2^31 - 1 entries when     *
+*    built with -DRCM_INDEX64 (lib_seq64 and lib_openmp64, which        *
+*    programs must be compiled with -DRCM_INDEX64 to link against).     *
+*    Dense n-by-n matrices are indexed with size_t in both              *
+*************************************************************************
+*/
+
+#ifdef RCM_INDEX64
+typedef int64_t RCMOffset;
+#define RCM_OFFSET_MAX INT64_MAX
+#else
+typedef int RCMOffset;
+#define RCM_OFFSET_MAX INT32_MAX
+#endif
+
 /*
 ********************************************************
 *    @file   rcm.h                                     *
@@ -46,18 +69,410 @@
 
 int *rcm(int *X, int n);
 
+/*
+************************************************************************
+*    --- Reverse Cuthill-McKee Algorithm (CSR input) ---               *
+*                                                                      *
+*    Same as rcm(), but the matrix is given in compressed sparse       *
+*    row format, so the whole algorithm runs in O(n + nnz) time        *
+*    and memory instead of O(n^2)                                      *
+*                                                                      *
+*    - param row_ptr  Row pointers                 [n+1]               *
+*    - param col_idx  Column indices               [nnz]               *
+*    - param n        Size of Matrix               [scalar]            *
+*                                                                      *
+*    NOTE: The pattern must be symmetric, with the column indices      *
+*          of every row sorted in increasing order and without         *
+*          duplicates. Diagonal entries are allowed and ignored.       *
+*          Under those conditions the result is identical to rcm()     *
+*          applied to the dense version of the same matrix             *
+************************************************************************
+*/
+
+int *rcm_csr(RCMOffset *row_ptr, int *col_idx, int n);
+
+/*
+************************************************************************
+*    --- Reverse Cuthill-McKee Algorithm (bit-packed input) ---        *
+*                                                                      *
+*    Same as rcm(), but the matrix is stored with one bit per entry    *
+*    (see BitMatrix), which takes 32 times less memory. Degrees are    *
+*    computed with popcount and neighbors are extracted by scanning    *
+*    the set bits of each row, 64 columns at a time                    *
+*                                                                      *
+*    - param B    Bit-packed matrix    [n-by-n]                        *
+*                                                                      *
+*    NOTE: The result is identical to rcm() applied to the             *
+*          dense version of the same matrix                            *
+************************************************************************
+*/
+
+typedef struct BitMatrix BitMatrix;
+
+int *rcm_bitset(BitMatrix *B);
+
+/*
+************************************************************************
+*    --- Start node of each component ---                              *
+*                                                                      *
+*    Choose how all the rcm functions above pick the node from         *
+*    which each connected component is traversed                       *
+*                                                                      *
+*    - RCM_START_MIN_DEGREE         The unvisited node of minimum      *
+*                                   degree (default)                   *
+*    - RCM_START_PSEUDO_PERIPHERAL  A pseudo-peripheral node, found    *
+*                                   by George-Liu's algorithm from     *
+*                                   the node of minimum degree. It     *
+*                                   usually gives a narrower band,     *
+*                                   at the cost of a few extra BFS     *
+*                                   sweeps (parallel with OpenMP)      *
+************************************************************************
+*/
+
+typedef enum RCMStartMode
+{
+	RCM_START_MIN_DEGREE,
+	RCM_START_PSEUDO_PERIPHERAL
+} RCMStartMode;
+
+void rcm_set_start_mode(RCMStartMode mode);
+RCMStartMode rcm_get_start_mode(void);
+
+/*
+************************************************************************
+*    --- Traversal engine ---                                          *
+*                                                                      *
+*    Choose how all the rcm functions above traverse each component.   *
+*    All engines give exactly the same permutation                     *
+*                                                                      *
+*    - RCM_ENGINE_QUEUE       One node at a time through a queue       *
+*                             (default)                                *
+*    - RCM_ENGINE_LEVELS      A whole BFS level at a time, expanded,   *
+*                             sorted and placed in parallel, so it     *
+*                             scales with the width of the levels      *
+*                             instead of a single row                  *
+*    - RCM_ENGINE_COMPONENTS  The queue, on all connected components   *
+*                             at once as tasks. Components are labeled *
+*                             first, and each one fills the slice of R *
+*                             the queue would have given it            *
+*                                                                      *
+*    The sequential library always uses the queue                      *
+************************************************************************
+*/
+
+typedef enum RCMEngine
+{
+	RCM_ENGINE_QUEUE,
+	RCM_ENGINE_LEVELS,
+	RCM_ENGINE_COMPONENTS
+} RCMEngine;
+
+void rcm_set_engine(RCMEngine engine);
+RCMEngine rcm_get_engine(void);
+
+/*
+************************************************************************
+*    --- Ordering ---                                                  *
+*                                                                      *
+*    Choose which ordering all the rcm functions above compute. They   *
+*    share the degrees, the queue and the workspace, and start every   *
+*    component from its node of minimum degree                         *
+*                                                                      *
+*    - RCM_ORDERING_RCM    Reverse Cuthill-McKee (default)             *
+*    - RCM_ORDERING_CM     Cuthill-McKee, not reversed. Same           *
+*                          bandwidth, usually a larger profile         *
+*    - RCM_ORDERING_SLOAN  Sloan's algorithm from the ends of a        *
+*                          pseudo-diameter. Reduces the profile and    *
+*                          the wavefront rather than the bandwidth     *
+*    - RCM_ORDERING_GPS    Gibbs-Poole-Stockmeyer: Cuthill-McKee on    *
+*                          the narrowest level structure it can build  *
+*                          from both ends of a pseudo-diameter,        *
+*                          reversed. Usually a narrower band than RCM  *
+*                                                                      *
+*    Sloan and GPS are sequential in both libraries, and ignore the    *
+*    start mode and the engine                                         *
+*                                                                      *
+*    - rcm_ordering_name()       Name of an ordering                   *
+*    - rcm_ordering_from_name()  Ordering of a name (rcm, cm, sloan    *
+*                                or gps), or -1                        *
+************************************************************************
+*/
+
+typedef enum RCMOrdering
+{
+	RCM_ORDERING_RCM,
+	RCM_ORDERING_CM,
+	RCM_ORDERING_SLOAN,
+	RCM_ORDERING_GPS,
+	RCM_NUM_ORDERINGS
+} RCMOrdering;
+
+void rcm_set_ordering(RCMOrdering ordering);
+RCMOrdering rcm_get_ordering(void);
+const char *rcm_ordering_name(RCMOrdering ordering);
+int rcm_ordering_from_name(const char *name);
+
+/*
+************************************************************************
+*    --- Backend ---                                                   *
+*                                                                      *
+*    The OpenMP library also holds the sequential implementation, so   *
+*    a program picks one at run time instead of at link time. Both     *
+*    give exactly the same permutation                                 *
+*                                                                      *
+*    - RCM_BACKEND_OPENMP      The library's own (default)             *
+*    - RCM_BACKEND_SEQUENTIAL  The sequential one, on the calling      *
+*                              thread only                             *
+*                                                                      *
+*    The sequential library always uses its own                        *
+************************************************************************
+*/
+
+typedef enum RCMBackend
+{
+	RCM_BACKEND_OPENMP,
+	RCM_BACKEND_SEQUENTIAL
+} RCMBackend;
+
+void rcm_set_backend(RCMBackend backend);
+RCMBackend rcm_get_backend(void);
+
+/*
+*************************************************************************
+*    --- Reusable workspace ---                                         *
+*                                                                       *
+*    The rcm functions take the neighbor buffers of every node from     *
+*    a bump arena, sized from the maximum degree, instead of            *
+*    allocating them one node at a time. rcm(), rcm_csr() and           *
+*    rcm_bitset() create one for every call. The _ws versions take      *
+*    it from the caller instead (NULL is allowed), so that a program    *
+*    reordering many matrices keeps a single one, which grows to the    *
+*    largest need it meets. A workspace must not be shared between      *
+*    threads                                                            *
+*                                                                       *
+*    - createWorkspace()   Initialize it with room for some ints        *
+*                          (NULL if out of memory)                      *
+*    - reserveWorkspace()  Make room for some ints in total (-1 if out  *
+*                          of memory). Pointers taken before are        *
+*                          invalid if it grows                          *
+*    - workspaceAlloc()    Take some ints from the top of the arena     *
+*                          (NULL if there is not enough room)           *
+*    - workspaceMark()     The current top of the arena                 *
+*    - workspaceRelease()  Give back everything taken after a mark      *
+*    - freeWorkspace()     Free it                                      *
+*************************************************************************
+*/
+
+typedef struct Workspace
+{
+	size_t capacity; // ints in the arena
+	size_t top;		 // ints taken from the arena
+	int *arena;
+} Workspace;
+
+Workspace *createWorkspace(size_t capacity);
+int reserveWorkspace(Workspace *W, size_t capacity);
+int *workspaceAlloc(Workspace *W, size_t count);
+size_t workspaceMark(Workspace *W);
+void workspaceRelease(Workspace *W, size_t mark);
+void freeWorkspace(Workspace *W);
+
+int *rcm_ws(int *X, int n, Workspace *W);
+int *rcm_csr_ws(RCMOffset *row_ptr, int *col_idx, int n, Workspace *W);
+int *rcm_bitset_ws(BitMatrix *B, Workspace *W);
+
+/*
+*************************************************************************
+*    --- Reusable context ---                                           *
+*                                                                       *
+*    For programs that reorder many matrices and must not stop on a     *
+*    failure. A context owns all the working arrays of the rcm          *
+*    functions in its workspace, which grows to the largest matrix it   *
+*    meets and is reused after, so reordering allocates nothing once    *
+*    it is large enough. The permutation goes to an array of n ints     *
+*    the caller gives, and failures are returned as an RCMStatus        *
+*    instead of ending the program. Every thread may use its own        *
+*    context at the same time                                           *
+*                                                                       *
+*    - createContext()      A context with the current start mode,      *
+*                           engine, ordering and backend (change its    *
+*                           fields to pick others),                     *
+*                           or NULL if out of memory                    *
+*    - rcm_ctx(), rcm_csr_ctx(), rcm_bitset_ctx()                       *
+*                           rcm(), rcm_csr() and rcm_bitset() on a      *
+*                           context, into permutation                   *
+*    - rcm_status_string()  Describe a status                           *
+*    - freeContext()        Free it, along with its workspace           *
+*                                                                       *
+*    The functions returning an array (or a matrix) return NULL when    *
+*    out of memory, as the rcm functions without a context do, and      *
+*    none of the library ever calls exit()                              *
+*************************************************************************
+*/
+
+typedef enum RCMStatus
+{
+	RCM_OK = 0,
+	RCM_ERROR_INVALID_ARGUMENT = -1, // NULL pointers, a negative size, a column out of range or a degree of n or more
+	RCM_ERROR_OUT_OF_MEMORY = -2
+} RCMStatus;
+
+typedef struct RCMContext
+{
+	Workspace *workspace;	 // working arrays, kept between calls
+	RCMStartMode start_mode; // start node of each component
+	RCMEngine engine;		 // traversal of each component
+	RCMOrdering ordering;	 // ordering computed
+	RCMBackend backend;		 // implementation that computes it
+} RCMContext;
+
+RCMContext *createContext(void);
+void freeContext(RCMContext *C);
+RCMStatus rcm_ctx(RCMContext *C, int *X, int n, int *permutation);
+RCMStatus rcm_csr_ctx(RCMContext *C, RCMOffset *row_ptr, int *col_idx, int n, int *permutation);
+RCMStatus rcm_bitset_ctx(RCMContext *C, BitMatrix *B, int *permutation);
+const char *rcm_status_string(RCMStatus status);
+
+/*
+*************************************************************************
+*    --- Batch reordering ---                                           *
+*                                                                       *
+*    For many small or medium matrices, whose reordering is too short   *
+*    to gain from the parallel phases. Instead, every matrix is         *
+*    reordered on a thread of its own, with a context per thread,       *
+*    and the threads take the matrices (the largest first) with         *
+*    dynamic scheduling. In the sequential library they are simply      *
+*    reordered one after the other                                      *
+*                                                                       *
+*    - rcm_csr_batch()  rcm_csr() of count matrices, into the arrays    *
+*                       permutations[k] of matrices[k]->n ints. The     *
+*                       status of every matrix goes to status[k], if    *
+*                       it is not NULL. Returns RCM_OK, or the status   *
+*                       of the first matrix that failed                 *
+*************************************************************************
+*/
+
+typedef struct CSR CSR;
+
+RCMStatus rcm_csr_batch(CSR **matrices, int count, int **permutations, RCMStatus *status);
+
+/*
+*************************************************************************
+*    --- Instrumentation ---                                            *
+*                                                                       *
+*    rcm_stats(), rcm_csr_stats() and rcm_bitset_stats() are rcm(),     *
+*    rcm_csr() and rcm_bitset(), that also fill stats with where the    *
+*    time went (NULL collects nothing). Every other call costs one      *
+*    check of a global pointer at each hook, and building the library   *
+*    with -DRCM_NO_STATS removes the hooks altogether. Setting          *
+*    RCM_STATS makes the main program collect and print them. Only      *
+*    one call at a time may collect stats                               *
+*                                                                       *
+*    - RCM_PHASE_DEGREES  Computing the degrees of all nodes            *
+*    - RCM_PHASE_START    Picking the start nodes: the scan for the     *
+*                         node of minimum degree, the pseudo-           *
+*                         peripheral search and the labeling of the     *
+*                         components                                    *
+*    - RCM_PHASE_GATHER   Gathering the neighbors of a node             *
+*    - RCM_PHASE_SORT     Sorting neighbors (or a level) by degree      *
+*    - RCM_PHASE_QUEUE    Enqueueing and dequeueing (or marking the     *
+*                         nodes of a level as inserted)                 *
+*                                                                       *
+*    The phases are timed on every thread that runs them, in its own    *
+*    slot. Time in OpenMP parallel regions is the wall time of the      *
+*    outermost ones, so it overlaps the phases. Those an if() clause    *
+*    runs serially count too                                            *
+*************************************************************************
+*/
+
+typedef enum RCMPhase
+{
+	RCM_PHASE_DEGREES,
+	RCM_PHASE_START,
+	RCM_PHASE_GATHER,
+	RCM_PHASE_SORT,
+	RCM_PHASE_QUEUE,
+	RCM_NUM_PHASES
+} RCMPhase;
+
+//! Thread slots (threads beyond them share the last) and histogram bins
+#define RCM_STATS_THREADS 64
+#define RCM_STATS_BINS 32
+
+typedef struct RCMStats
+{
+	double total_time;									// wall time of the call, in seconds
+	double time[RCM_STATS_THREADS][RCM_NUM_PHASES];		// time of each phase on each thread
+	long long calls[RCM_STATS_THREADS][RCM_NUM_PHASES]; // times each phase ran on each thread
+	long long neighbors[RCM_STATS_BINS];				// neighbor lists of size 0 in bin 0, in [2^(b-1), 2^b) in bin b
+	double region_time;									// wall time in OpenMP parallel regions
+	long long regions;									// OpenMP parallel regions entered
+	int threads;										// thread slots used
+} RCMStats;
+
+int *rcm_stats(int *X, int n, RCMStats *stats);
+int *rcm_csr_stats(RCMOffset *row_ptr, int *col_idx, int n, RCMStats *stats);
+int *rcm_bitset_stats(BitMatrix *B, RCMStats *stats);
+const char *rcm_phase_name(RCMPhase phase);
+
+/*
+*************************************************************************
+*    --- Tuning ---                                                     *
+*                                                                       *
+*    Below a threshold of elements a phase of rcm_openmp runs           *
+*    serially, because a parallel region would cost more than it        *
+*    saves. Above it the phase runs on its own number of threads (0     *
+*    for all of them). The defaults were tuned on a 4-core laptop       *
+*                                                                       *
+*    - rcm_set_tuning()    Use these thresholds and threads             *
+*    - rcm_get_tuning()    The ones in use                              *
+*    - rcm_calibrate()     Time the serial and the parallel kernels     *
+*                          on this host and fill T with the best        *
+*                          ones. Takes a few seconds and does not       *
+*                          apply them, nor change the ones that         *
+*                          reorderings running meanwhile use            *
+*    - rcm_load_tuning()   Apply the "name = value" lines of a file     *
+*    - rcm_save_tuning()   Write T in that format                       *
+*                                                                       *
+*    The sequential library keeps them but never reads them. The main   *
+*    program loads the file RCM_TUNING names (rcm.tuning by default)    *
+*    at startup, and './openmp --calibrate [file]' writes it            *
+*************************************************************************
+*/
+
+typedef struct RCMTuning
+{
+	int loop_threshold;		 // THRES_1: degrees, scans and loops over the nodes
+	int gather_threshold;	 // THRES_2: columns of a dense or bitset row to gather
+	int sort_threshold;		 // THRES_3: keys for the parallel radix sort
+	int level_threshold;	 // THRES_4: nodes of a level to expand in parallel
+	int component_threshold; // THRES_5: nodes of a component to order on its own
+	int loop_threads;
+	int gather_threads;
+	int sort_threads;
+	int level_threads;
+} RCMTuning;
+
+void rcm_set_tuning(const RCMTuning *T);
+void rcm_get_tuning(RCMTuning *T);
+void rcm_calibrate(RCMTuning *T);
+int rcm_load_tuning(const char *filename);
+int rcm_save_tuning(const char *filename, const RCMTuning *T);
+
 /*
 **********************************************************************
 *    --- Queue implementation ---                                    *
 *                                                                    *
 *    A set of functions to demonstrate the functioning of a queue    *
 *                                                                    *
-*    - createQueue() Initialize queue and its values                 *
-*    - enqueue()     Insert an item                                  *
+*    - createQueue() Initialize queue and its values (NULL if out    *
+*                    of memory)                                      *
+*    - enqueue()     Insert an item (-1 if queue is full)            *
 *    - dequeue()     Remove an item                                  *
-*    - peek()        See first element                               *
+*    - peek()        See first element (-1 if queue is empty)        *
 *    - isEmpty()     Check if queue is empty                         *
 *    - isFull()      Check if queue is full                          *
+*    - freeQueue()   Free queue and its elements                     *
 **********************************************************************
 */
 
@@ -71,11 +486,46 @@ typedef struct Queue
 } Queue;
 
 Queue *createQueue(int max_elements);
-void enqueue(Queue *Q, int element);
+int enqueue(Queue *Q, int element);
 void dequeue(Queue *Q);
 int peek(Queue *Q);
 int isEmpty(Queue *Q);
 int isFull(Queue *Q);
+void freeQueue(Queue *Q);
+
+/*
+*************************************************************************
+*    --- Start node selection ---                                       *
+*                                                                       *
+*    Every component of the graph starts from its node of minimum       *
+*    degree. The nodes are sorted once by degree (ties by index,        *
+*    with a stable counting sort), and a cursor moves over them,        *
+*    so that finding each next start node costs amortized O(1)          *
+*    instead of a scan over all n nodes                                 *
+*                                                                       *
+*    - createStartSelector()  Sort the nodes by degree (NULL if out     *
+*                             of memory)                                *
+*    - initStartSelector()    Sort them into order [n], given counts    *
+*                             [n+1] of working space, for a selector    *
+*                             that allocates nothing                    *
+*    - nextStartNode()        Return the unvisited node of minimum      *
+*                             degree (the one with the smallest index   *
+*                             among equal degrees), or -1 if none       *
+*    - freeStartSelector()    Free the selector                         *
+*************************************************************************
+*/
+
+typedef struct StartSelector
+{
+	int n;		// number of nodes
+	int cursor; // position of the first node which may be unvisited
+	int *order; // nodes sorted in increasing order of degree [n]
+} StartSelector;
+
+StartSelector *createStartSelector(int *degrees, int n);
+void initStartSelector(StartSelector *S, int *degrees, int n, int *order, int *counts);
+int nextStartNode(StartSelector *S, int *inserted);
+void freeStartSelector(StartSelector *S);
 
 /*
 *****************************************************************************
@@ -91,17 +541,55 @@ int isFull(Queue *Q);
 *    - param inserted      Shows if the node is already inserted to R       *    
 *    - param Q             Queue array          [n-by-n]                    *
 *    - param element_idx   Element of which neighbors are to be inserted    *
+*    - param W             Workspace of the buffers (NULL for a temporary)  *
+*                                                                           *
+*    They return 0, or -1 if the buffers could not be allocated or Q        *
+*    overflowed                                                             *
 *                                                                           *
 *    The parallel version of it, also has this argument                     *
 *                                                                           *
 *    - param last_neigbor_idx   Index of the element's last neighbor        *
+*                                                                           *
+*    The CSR version of it takes the row pointers and column indices        *
+*    of the matrix (see rcm_csr()) in place of X and n, and the bitset      *
+*    version takes the bit-packed matrix (see rcm_bitset())                 *
 *****************************************************************************
 */
-void add_neighbors_to_queue(int *X, int n, int *degrees,
-							int *inserted, Queue *Q, int element_idx);
+int add_neighbors_to_queue(int *X, int n, int *degrees,
+						   int *inserted, Queue *Q, int element_idx, Workspace *W);
+
+int add_neighbors_to_queue_parallel(int *X, int n, int *degrees, int *inserted,
+									Queue *Q, int element_idx, int last_neighbor_idx, Workspace *W);
+
+int add_neighbors_to_queue_csr(RCMOffset *row_ptr, int *col_idx, int *degrees,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W);
 
-void add_neighbors_to_queue_parallel(int *X, int n, int *degrees, int *inserted,
-									 Queue *Q, int element_idx, int last_neighbor_idx);
+int add_neighbors_to_queue_bitset(BitMatrix *B, int *degrees,
+								  int *inserted, Queue *Q, int element_idx, Workspace *W);
+
+/*
+*************************************************************************
+*    --- Dense row kernels ---                                          *
+*                                                                       *
+*    Vectorized scans over a row of a dense matrix. AVX-512 or AVX2     *
+*    versions are picked at runtime according to the CPU, with a        *
+*    portable scalar fallback (forced by setting RCM_NO_SIMD)           *
+*                                                                       *
+*    - row_count_nonzeros()   Count the nonzeros of row[0..n-1],        *
+*                             except column skip. If last is not        *
+*                             NULL, also store there the index of the   *
+*                             last of them (0 if there is none)         *
+*    - row_gather_nonzeros()  Store the indices of the nonzeros of      *
+*                             row[from..to-1], except column skip, to   *
+*                             neighbors in increasing order and return  *
+*                             how many they were                        *
+*    - row_kernels_name()     Name of the kernels in use                *
+*************************************************************************
+*/
+
+int row_count_nonzeros(const int *row, int n, int skip, int *last);
+int row_gather_nonzeros(const int *row, int from, int to, int skip, int *neighbors);
+const char *row_kernels_name(void);
 
 /*
 **************************************************************************
@@ -121,34 +609,325 @@ void quickSort(int arr1[], int arr2[], int low, int high);
 void swap(int *a, int *b);
 
 /*
-**********************************************************************
-*    --- Graph implementation ---                                    *
-*                                                                    *
-*    A set of functions to demonstrate the functioning of a graph    *
-*    - createNode()     Create a node                                *
-*    - createGraph()    Create a graph                               *
-*    - addEdge()        Add an edge                                  *
-*    - printGraph()     Print the graph                              *
-**********************************************************************
+**************************************************************************
+*    --- Stable sort by degree ---                                       *
+*                                                                        *
+*    Sort a given array, depending on the values of a different array,   *
+*    keeping elements with equal values in their original order.         *
+*    Short arrays are sorted with insertion sort, and longer ones with   *
+*    a least significant digit radix sort (8 bits per pass) on their     *
+*    values, which takes linear time however many values are equal       *
+*                                                                        *
+*    - arr1[]     Array to be sorted                                     *
+*    - arr2[]     Array on which the sorting depends (non-negative)      *
+*    - n          Number of elements of arr1                             *
+*    - scratch[]  Working space of at least n elements, reused between   *
+*                 calls. If NULL, it is allocated when needed            *
+**************************************************************************
 */
 
-typedef struct node
-{
-	int vertex;
-	struct node *next;
-} node;
+void degreeSort(int arr1[], int arr2[], int n, int scratch[]);
+void insertionSort(int arr1[], int arr2[], int n);
+void radixSort(int arr1[], int arr2[], int n, int scratch[]);
+
+/*
+**************************************************************************
+*    --- Graph implementation ---                                        *
+*                                                                        *
+*    A graph stored in contiguous arrays: the neighbors of vertex v      *
+*    are adjacency[offsets[v] .. offsets[v+1]-1]. Builders count the     *
+*    neighbors of every vertex, turn the counts to offsets with a        *
+*    prefix sum and then fill the lists, both passes in parallel         *
+*                                                                        *
+*    - createGraph()     Allocate a graph with some vertices and         *
+*                        (directed) edges                                *
+*    - freeGraph()       Free a graph                                    *
+*    - dense_to_graph()  Build the graph of a dense symmetric matrix     *
+*    - permute_graph()   Build the graph whose vertex i is vertex        *
+*                        permutation[i] of the given one                 *
+*    - graph_to_dense()  Store a graph to a dense matrix, with ones on   *
+*                        the diagonal                                    *
+*    - printGraph()      Print the graph                                 *
+**************************************************************************
+*/
 
 typedef struct Graph
 {
 	int numVertices;
-	node **adjLists;
+	RCMOffset numEdges; // every undirected edge is stored in both directions
+	RCMOffset *offsets; // [numVertices + 1]
+	int *adjacency;		// [numEdges]
 } Graph;
 
-Graph *createGraph(int vertices);
-node *createNode(int v);
-void addEdge(Graph *graph, int s, int d);
+Graph *createGraph(int vertices, RCMOffset edges);
+void freeGraph(Graph *graph);
+Graph *dense_to_graph(int *X, int n);
+Graph *permute_graph(Graph *graph, int *permutation);
+void graph_to_dense(Graph *graph, int *X);
 void printGraph(Graph *graph);
 
+/*
+***********************************************************************
+*    --- Compressed Sparse Row (CSR) matrix ---                       *
+*                                                                     *
+*    The neighbors of row i are col_idx[row_ptr[i] .. row_ptr[i+1]-1] *
+*                                                                     *
+*    - createCSR()     Allocate a CSR matrix with n rows and nnz      *
+*                      stored entries                                 *
+*    - freeCSR()       Free a CSR matrix                              *
+*    - dense_to_csr()  Convert a dense row-major matrix to CSR        *
+***********************************************************************
+*/
+
+struct CSR
+{
+	int n;		  // number of rows (and columns)
+	RCMOffset nnz;		// number of stored entries
+	RCMOffset *row_ptr; // row pointers [n+1]
+	int *col_idx;		// column indices [nnz]
+};
+
+CSR *createCSR(int n, RCMOffset nnz);
+void freeCSR(CSR *A);
+CSR *dense_to_csr(int *X, int n);
+
+/*
+*************************************************************************
+*    --- Matrix input/output ---                                        *
+*                                                                       *
+*    - read_mtx()          Read a Matrix Market coordinate file to      *
+*                          CSR. Values are ignored and the pattern is   *
+*                          symmetrized (A + A'), with sorted columns    *
+*    - read_csr_binary()   Read a matrix stored by write_csr_binary()   *
+*    - read_bitmatrix_binary()                                          *
+*                          Read a matrix stored by                      *
+*                          write_bitmatrix_binary()                     *
+*    - read_matrix()       read_mtx() for .mtx files, read_csr_binary() *
+*                          for anything else                            *
+*    - read_matrices()     read_matrix() of count files, one per        *
+*                          thread, into matrices[k] (NULL for those     *
+*                          that failed). Returns how many failed        *
+*    - write_csr_binary()  Store a CSR matrix in a compact binary file  *
+*                          for fast reloads                             *
+*    - write_bitmatrix_binary()                                         *
+*                          Store a bit-packed matrix as its header and  *
+*                          raw words, which map_matrix() can map        *
+*    - write_mtx()         Store the lower triangle of a symmetric      *
+*                          pattern as a Matrix Market coordinate file   *
+*    - write_dense_csv()   Store a pattern as a dense 0/1 CSV, with     *
+*                          ones on the diagonal (as graph_to_dense())   *
+*    - write_matrix()      Pick one of the above by the file name:      *
+*                          .mtx, .csv, .bits (bit-packed, with ones on  *
+*                          the diagonal), or binary CSR for anything    *
+*                          else                                         *
+*    - write_permutation() Store a permutation as n raw native ints     *
+*                                                                       *
+*    The readers return NULL and the writers return -1 on failure       *
+*                                                                       *
+*    NOTE: With OpenMP the coordinate section is parsed in parallel,    *
+*    and the text files are formatted in parallel straight into a       *
+*    memory mapping of the file                                         *
+*************************************************************************
+*/
+
+CSR *read_mtx(const char *filename);
+CSR *read_csr_binary(const char *filename);
+CSR *read_matrix(const char *filename);
+int read_matrices(char **filenames, int count, CSR **matrices);
+int write_csr_binary(const char *filename, CSR *A);
+BitMatrix *read_bitmatrix_binary(const char *filename);
+int write_bitmatrix_binary(const char *filename, BitMatrix *B);
+int write_mtx(const char *filename, CSR *A);
+int write_dense_csv(const char *filename, CSR *A);
+int write_matrix(const char *filename, CSR *A);
+int write_permutation(const char *filename, const int *permutation, int n);
+
+/*
+*************************************************************************
+*    --- Matrix generators ---                                          *
+*                                                                       *
+*    Symmetric patterns with the diagonal set and sorted columns,       *
+*    generated straight to CSR in O(n + nnz) and in parallel. Every     *
+*    row draws its own stream of random numbers from the seed, so the   *
+*    same seed gives the same matrix at any number of threads           *
+*                                                                       *
+*    - generate_random_csr()     Every entry above the diagonal set     *
+*                                with probability p (Erdos-Renyi)       *
+*    - generate_grid_csr()       Pattern of the 5-point (nz = 1) or     *
+*                                7-point Laplacian of an nx-by-ny-by-nz *
+*                                grid, numbered x first                 *
+*    - generate_banded_csr()     Every entry within bandwidth of the    *
+*                                diagonal, and the rest with            *
+*                                probability p                          *
+*    - generate_power_law_csr()  Chung-Lu graph with the given mean     *
+*                                degree and a power law of degrees      *
+*                                with the given exponent (> 1)          *
+*    - generate_graph()          A matrix of the family of about n      *
+*                                rows (grids round n down to a square   *
+*                                or cube) and about density percent     *
+*                                of entries, as in the main program     *
+*    - rcm_graph_name()          Name of a family                       *
+*    - rcm_graph_from_name()     Family of a name, or -1                *
+*                                                                       *
+*    They return NULL on invalid arguments or out of memory             *
+*************************************************************************
+*/
+
+typedef enum RCMGraph
+{
+	RCM_GRAPH_RANDOM,
+	RCM_GRAPH_GRID2D,
+	RCM_GRAPH_GRID3D,
+	RCM_GRAPH_BANDED,
+	RCM_GRAPH_POWER_LAW,
+	RCM_NUM_GRAPHS
+} RCMGraph;
+
+CSR *generate_random_csr(int n, double p, uint64_t seed);
+CSR *generate_grid_csr(int nx, int ny, int nz);
+CSR *generate_banded_csr(int n, int bandwidth, double p, uint64_t seed);
+CSR *generate_power_law_csr(int n, double degree, double exponent, uint64_t seed);
+CSR *generate_graph(RCMGraph graph, int n, double density, uint64_t seed);
+const char *rcm_graph_name(RCMGraph graph);
+int rcm_graph_from_name(const char *name);
+
+/*
+*************************************************************************
+*    --- Applying a permutation ---                                     *
+*                                                                       *
+*    For the permutation P returned by the rcm functions, where row i   *
+*    of the reordered matrix is row permutation[i] of the original.     *
+*    All of them run in parallel with OpenMP                            *
+*                                                                       *
+*    - inverse_permutation()  Position of every row in the permutation  *
+*    - permute_pattern()      P A P' of a sparsity pattern, into the    *
+*                             given arrays (n + 1 offsets and nnz       *
+*                             ints). If sort_rows is nonzero, the       *
+*                             columns of every row are sorted.          *
+*                             Returns 0, or -1 if out of memory         *
+*    - permute_csr()          P A P' of a CSR matrix, as a new one      *
+*    - permute_vector()       y = P x, e.g. of a right-hand side        *
+*    - unpermute_vector()     x = P' y, e.g. of the solution            *
+*************************************************************************
+*/
+
+int *inverse_permutation(const int *permutation, int n);
+int permute_pattern(int n, const RCMOffset *row_ptr, const int *col_idx, const int *permutation,
+					RCMOffset *new_row_ptr, int *new_col_idx, int sort_rows);
+CSR *permute_csr(CSR *A, const int *permutation, int sort_rows);
+void permute_vector(const double *x, const int *permutation, int n, double *y);
+void unpermute_vector(const double *y, const int *permutation, int n, double *x);
+
+/*
+***********************************************************************
+*    --- Bit-packed matrix ---                                        *
+*                                                                     *
+*    Row i occupies words_per_row 64-bit words, starting at           *
+*    bits[i * words_per_row], and column j of it is bit (j % 64)      *
+*    of word (j / 64). Unused bits of the last word are zero          *
+*                                                                     *
+*    - createBitMatrix()     Allocate an n-by-n matrix of zeros       *
+*    - freeBitMatrix()       Free a bit-packed matrix                 *
+*    - dense_to_bitmatrix()  Pack a dense row-major matrix            *
+*    - bitmatrix_set()       Set entry (i,j) to one                   *
+*    - bitmatrix_get()       Return entry (i,j) (0 or 1)              *
+***********************************************************************
+*/
+
+struct BitMatrix
+{
+	int n;			   // number of rows (and columns)
+	int words_per_row; // 64-bit words per row, (n + 63) / 64
+	uint64_t *bits;	   // the matrix [n * words_per_row]
+};
+
+BitMatrix *createBitMatrix(int n);
+void freeBitMatrix(BitMatrix *B);
+BitMatrix *dense_to_bitmatrix(int *X, int n);
+void bitmatrix_set(BitMatrix *B, int i, int j);
+int bitmatrix_get(BitMatrix *B, int i, int j);
+
+/*
+*************************************************************************
+*    --- Memory-mapped input ---                                        *
+*                                                                       *
+*    Reorder a binary CSR or bit-packed matrix file straight from the   *
+*    page cache, without reading it to memory first: opening costs the  *
+*    same for any size of file, and only what is touched is ever read.  *
+*    The matrix is mapped copy-on-write, so its arrays may even be      *
+*    changed without changing the file                                  *
+*                                                                       *
+*    - map_matrix()     Map a file (whichever of the two formats it     *
+*                       is, by its header) into M->csr or               *
+*                       M->bitmatrix, or return NULL. Row pointers of   *
+*                       another width than RCMOffset are converted,     *
+*                       which costs n + 1 of them. RCM_MAP_HUGE_PAGES   *
+*                       asks for huge pages, which only file systems    *
+*                       that support them for files grant               *
+*    - unmap_matrix()   Unmap it                                        *
+*    - advise_mapped()  If data lies in a mapped matrix, tell the       *
+*                       kernel how the rest of it will be read. The     *
+*                       mapping asks for sequential reads, for the      *
+*                       degree pass, and the rcm functions switch to    *
+*                       random ones for the traversal. Does nothing     *
+*                       for other memory                                *
+*************************************************************************
+*/
+
+#define RCM_MAP_HUGE_PAGES 1
+
+typedef enum RCMAccess
+{
+	RCM_ACCESS_SEQUENTIAL,
+	RCM_ACCESS_RANDOM
+} RCMAccess;
+
+typedef struct MappedMatrix
+{
+	CSR csr;			 // binary CSR files: arrays inside the mapping
+	BitMatrix bitmatrix; // bit-packed files: bits inside the mapping
+	int is_bitmatrix;	 // which of the two the file holds
+	void *map;			 // the mapping, and its length
+	size_t size;
+	RCMOffset *row_ptr; // converted row pointers, or NULL
+} MappedMatrix;
+
+MappedMatrix *map_matrix(const char *filename, int flags);
+void unmap_matrix(MappedMatrix *M);
+void advise_mapped(const void *data, RCMAccess access);
+
+/*
+*************************************************************************
+*    --- Ordering quality metrics ---                                   *
+*                                                                       *
+*    - calc_metrics_csr()  Metrics of a CSR (or Graph) matrix in        *
+*                          O(n + nnz), in parallel. If permutation is   *
+*                          not NULL, they are those of P A P', found    *
+*                          without building it. The diagonal counts     *
+*                          as present whether it is stored or not.      *
+*                          The bandwidth of a row is the distance of    *
+*                          its first column from the diagonal.          *
+*                          Returns 0, or -1 if out of memory            *
+*************************************************************************
+*/
+
+//! Number of bins of the histogram of row bandwidths
+#define METRICS_BINS 32
+
+typedef struct Metrics
+{
+	int bandwidth;				 // lower + upper + 1, as calc_bandwidth()
+	int lower_bandwidth;		 // max i - j over all entries
+	int upper_bandwidth;		 // max j - i over all entries
+	long long profile;			 // sum of the row bandwidths (envelope size)
+	int max_wavefront;			 // max number of rows active at a step
+	double mean_wavefront;		 // mean number of rows active at a step
+	double rms_wavefront;		 // root mean square of the above
+	int histogram[METRICS_BINS]; // rows of bandwidth 0 in bin 0, in [2^(b-1), 2^b) in bin b
+} Metrics;
+
+int calc_metrics_csr(const RCMOffset *row_ptr, const int *col_idx, int n, const int *permutation, Metrics *M);
+
 /*
 ************************************************************************
 *    --- Helper Functions ---                                          *
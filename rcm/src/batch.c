@@ -0,0 +1,102 @@
+/*
+*****************************************************
+*    Reordering many independent matrices at once    *
+*****************************************************
+*/
+
+#include "../inc/rcm.h"
+
+//! A matrix of the batch and its size, to hand out the largest first
+typedef struct BatchItem
+{
+	int index;
+	long long size;
+} BatchItem;
+
+static int compare_size(const void *a, const void *b);
+
+/*
+*************************************************************************
+*    Every thread takes its own context and reorders whole matrices,    *
+*    one at a time, with dynamic scheduling. The matrices are handed    *
+*    out from the largest to the smallest, so that a large one does     *
+*    not start last and keep a single thread busy at the end, and the  *
+*    workspace of each thread grows once, at its first matrix. Each     *
+*    reordering runs serially on its thread, whatever its size          *
+*************************************************************************
+*/
+
+RCMStatus rcm_csr_batch(CSR **matrices, int count, int **permutations, RCMStatus *status)
+{
+	if (count < 0 || (count > 0 && (matrices == NULL || permutations == NULL)))
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	BatchItem *items = malloc((count > 0 ? count : 1) * sizeof(BatchItem));
+	if (items == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for the batch failed\n\n");
+		return RCM_ERROR_OUT_OF_MEMORY;
+	}
+
+	for (int k = 0; k < count; k++)
+	{
+		items[k].index = k;
+		items[k].size = (matrices[k] != NULL) ? (long long)matrices[k]->n + matrices[k]->nnz : 0;
+	}
+	qsort(items, count, sizeof(BatchItem), compare_size);
+
+	//! The first failure, in the order of the batch
+	int first_failed = count;
+	RCMStatus first_status = RCM_OK;
+
+#pragma omp parallel
+	{
+		RCMContext *C = createContext();
+
+#pragma omp for schedule(dynamic, 1)
+		for (int k = 0; k < count; k++)
+		{
+			int i = items[k].index;
+			CSR *A = matrices[i];
+
+			RCMStatus result;
+			if (C == NULL)
+				result = RCM_ERROR_OUT_OF_MEMORY;
+			else if (A == NULL)
+				result = RCM_ERROR_INVALID_ARGUMENT;
+			else
+				result = rcm_csr_ctx(C, A->row_ptr, A->col_idx, A->n, permutations[i]);
+
+			if (status != NULL)
+				status[i] = result;
+
+			if (result != RCM_OK)
+			{
+#pragma omp critical(batch_failure)
+				if (i < first_failed)
+				{
+					first_failed = i;
+					first_status = result;
+				}
+			}
+		}
+
+		freeContext(C);
+	}
+
+	free(items);
+
+	return first_status;
+}
+
+//! Larger first, and in the order of the batch among equal sizes
+static int compare_size(const void *a, const void *b)
+{
+	const BatchItem *x = a;
+	const BatchItem *y = b;
+
+	if (x->size != y->size)
+		return (x->size < y->size) ? 1 : -1;
+
+	return (x->index > y->index) - (x->index < y->index);
+}
@@ -0,0 +1,435 @@
+/*
+*******************************************************************
+*    Random and structured sparse symmetric matrices, as CSR      *
+*******************************************************************
+*/
+
+#include "../inc/rcm.h"
+
+static const char *graph_names[RCM_NUM_GRAPHS] = {"random", "grid2d", "grid3d", "banded", "powerlaw"};
+
+//! Exponent of the degree distribution of generate_graph()'s power-law graphs
+#define POWER_LAW_EXPONENT 2.5
+
+/*
+***********************************************************************
+*    Parameters of a family, and the state of the generation of one   *
+*    row. Every row draws its own stream of random numbers, the k-th  *
+*    of which is a hash of (seed, row, k), so the rows can be         *
+*    generated by any thread, in any order, as many times as needed,  *
+*    and always come out the same                                     *
+***********************************************************************
+*/
+
+typedef struct Generator
+{
+	RCMGraph graph;
+	int n;
+	int nx, ny, nz;		 // grid sides
+	int bandwidth;		 // banded: columns on each side of the diagonal
+	double p;			 // random, banded: probability of an entry (outside the band)
+	double *weights;	 // power law: expected degrees, in decreasing order
+	double total_weight; // power law: sum of the weights
+	uint64_t seed;
+} Generator;
+
+typedef struct RowSampler
+{
+	int i;			  // row
+	int j;			  // last column returned, i before the first
+	int step;		  // grid: next direction, banded: 1 once past the band
+	double p;		  // power law: probability of the last column tried
+	uint64_t key;	  // stream of the row
+	uint64_t counter; // numbers drawn from it
+} RowSampler;
+
+static CSR *generate(Generator *G);
+static void start_row(Generator *G, RowSampler *S, int i);
+static int next_column(Generator *G, RowSampler *S);
+static int skip_columns(RowSampler *S, int from, int n, double p);
+static uint64_t mix64(uint64_t x);
+static double uniform(RowSampler *S);
+static int compare_int(const void *a, const void *b);
+
+/*
+***********************************************
+*    Functions exported through the header    *
+***********************************************
+*/
+
+CSR *generate_random_csr(int n, double p, uint64_t seed)
+{
+	Generator G = {.graph = RCM_GRAPH_RANDOM, .n = n, .p = p, .seed = seed};
+
+	return generate(&G);
+}
+
+CSR *generate_grid_csr(int nx, int ny, int nz)
+{
+	if (nx < 1 || ny < 1 || nz < 1 || (long long)nx * ny * nz > INT32_MAX)
+	{
+		printf(RED "Error:" RESET_COLOR " Invalid grid size %dx%dx%d\n\n", nx, ny, nz);
+		return NULL;
+	}
+
+	Generator G = {.graph = (nz > 1) ? RCM_GRAPH_GRID3D : RCM_GRAPH_GRID2D, .n = nx * ny * nz, .nx = nx, .ny = ny, .nz = nz};
+
+	return generate(&G);
+}
+
+CSR *generate_banded_csr(int n, int bandwidth, double p, uint64_t seed)
+{
+	Generator G = {.graph = RCM_GRAPH_BANDED, .n = n, .bandwidth = (bandwidth > 0) ? bandwidth : 0, .p = p, .seed = seed};
+
+	return generate(&G);
+}
+
+/*
+*************************************************************************
+*    Chung-Lu graph: i and j are connected with probability             *
+*    min(1, w_i w_j / sum(w)), so node i has about w_i neighbors.       *
+*    w_i falls as (i + 1)^(-1 / (exponent - 1)), which gives degrees    *
+*    distributed as a power law of that exponent. Since the weights     *
+*    decrease, the probability of every next column of a row is lower,  *
+*    so the columns are skipped geometrically with the probability of   *
+*    the last one tried and then accepted with the ratio of the two     *
+*    (Miller and Hagberg), in O(n + nnz)                                *
+*************************************************************************
+*/
+
+CSR *generate_power_law_csr(int n, double degree, double exponent, uint64_t seed)
+{
+	if (n < 0 || exponent <= 1)
+	{
+		printf(RED "Error:" RESET_COLOR " Invalid power law graph (n %d, exponent %g)\n\n", n, exponent);
+		return NULL;
+	}
+
+	double *weights = malloc((n > 0 ? n : 1) * sizeof(double));
+	if (weights == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'weights' failed\n\n");
+		return NULL;
+	}
+
+	double alpha = 1 / (exponent - 1);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		weights[i] = pow(i + 1, -alpha);
+
+	//! Summed in index order, since a parallel reduction would round
+	//! differently for every number of threads, and so would the graph
+	double sum = 0;
+	for (int i = 0; i < n; i++)
+		sum += weights[i];
+
+	//! Scale them to the mean degree asked for
+	double scale = (sum > 0) ? degree * n / sum : 0;
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		weights[i] *= scale;
+
+	Generator G = {.graph = RCM_GRAPH_POWER_LAW, .n = n, .weights = weights, .total_weight = sum * scale, .seed = seed};
+	CSR *A = generate(&G);
+
+	free(weights);
+
+	return A;
+}
+
+CSR *generate_graph(RCMGraph graph, int n, double density, uint64_t seed)
+{
+	double p = 0.01 * density;
+	if (p > 1)
+		p = 1;
+
+	switch (graph)
+	{
+	case RCM_GRAPH_RANDOM:
+		return generate_random_csr(n, p, seed);
+	case RCM_GRAPH_GRID2D:
+	{
+		int side = (int)floor(sqrt((double)n));
+		return generate_grid_csr(side, side, 1);
+	}
+	case RCM_GRAPH_GRID3D:
+	{
+		int side = (int)floor(cbrt((double)n));
+		return generate_grid_csr(side, side, side);
+	}
+	case RCM_GRAPH_BANDED:
+		//! The band holds the density asked for, the noise 1% of it
+		return generate_banded_csr(n, (int)(p * n / 2), p / 100, seed);
+	case RCM_GRAPH_POWER_LAW:
+		return generate_power_law_csr(n, p * n, POWER_LAW_EXPONENT, seed);
+	default:
+		printf(RED "Error:" RESET_COLOR " Unknown graph family %d\n\n", graph);
+		return NULL;
+	}
+}
+
+const char *rcm_graph_name(RCMGraph graph)
+{
+	return (graph >= 0 && graph < RCM_NUM_GRAPHS) ? graph_names[graph] : "unknown";
+}
+
+int rcm_graph_from_name(const char *name)
+{
+	for (int g = 0; g < RCM_NUM_GRAPHS; g++)
+		if (strcmp(name, graph_names[g]) == 0)
+			return g;
+
+	return -1;
+}
+
+/*
+*************************************************************************
+*    Every row generates its columns above the diagonal, in             *
+*    increasing order. A first pass counts them for their own row and   *
+*    for the rows they mirror to, and after a prefix sum a second pass  *
+*    generates them again, storing them to their row right after the    *
+*    diagonal, and to the rows they mirror to before it. The mirrored   *
+*    ones arrive in any order, so they are sorted last. Each pass is    *
+*    over independent rows in parallel, and costs O(n + nnz)            *
+*************************************************************************
+*/
+
+static CSR *generate(Generator *G)
+{
+	int n = G->n;
+	if (n < 0)
+	{
+		printf(RED "Error:" RESET_COLOR " Invalid matrix size %d\n\n", n);
+		return NULL;
+	}
+
+	RCMOffset *counts = calloc((size_t)n + 1, sizeof(RCMOffset));
+	int *upper = malloc((n > 0 ? n : 1) * sizeof(int));
+	if (counts == NULL || upper == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'counts' failed\n\n");
+		free(counts);
+		free(upper);
+		return NULL;
+	}
+
+	//! Count the entries of every row, the diagonal included
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < n; i++)
+	{
+		RowSampler S;
+		start_row(G, &S, i);
+
+		int count = 0;
+		int j;
+		while ((j = next_column(G, &S)) >= 0)
+		{
+#pragma omp atomic
+			counts[j + 1]++;
+			count++;
+		}
+		upper[i] = count;
+
+#pragma omp atomic
+		counts[i + 1] += count + 1;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		if (counts[i + 1] > RCM_OFFSET_MAX - counts[i])
+		{
+			printf(RED "Error:" RESET_COLOR " The matrix has too many entries for 32-bit row pointers (see RCM_INDEX64)\n\n");
+			free(counts);
+			free(upper);
+			return NULL;
+		}
+		counts[i + 1] += counts[i];
+	}
+
+	CSR *A = createCSR(n, counts[n]);
+	if (A == NULL)
+	{
+		free(counts);
+		free(upper);
+		return NULL;
+	}
+	memcpy(A->row_ptr, counts, ((size_t)n + 1) * sizeof(RCMOffset));
+
+	//! Store the entries. counts[i] becomes where the next entry
+	//! below the diagonal of row i goes
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < n; i++)
+	{
+		RowSampler S;
+		start_row(G, &S, i);
+
+		RCMOffset diagonal = A->row_ptr[i + 1] - upper[i] - 1;
+		A->col_idx[diagonal] = i;
+
+		RCMOffset k = diagonal + 1;
+		int j;
+		while ((j = next_column(G, &S)) >= 0)
+		{
+			A->col_idx[k++] = j;
+
+			RCMOffset pos;
+#pragma omp atomic capture
+			pos = counts[j]++;
+			A->col_idx[pos] = i;
+		}
+	}
+
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < n; i++)
+	{
+		int length = A->row_ptr[i + 1] - upper[i] - 1 - A->row_ptr[i];
+		if (length > 1)
+			qsort(A->col_idx + A->row_ptr[i], length, sizeof(int), compare_int);
+	}
+
+	free(counts);
+	free(upper);
+
+	return A;
+}
+
+static void start_row(Generator *G, RowSampler *S, int i)
+{
+	S->i = i;
+	S->j = i;
+	S->step = 0;
+	S->p = 1;
+	S->key = mix64(G->seed ^ mix64((uint64_t)i + 0x9E3779B97F4A7C15ULL));
+	S->counter = 0;
+}
+
+//! The next column of the row above the diagonal, or -1 if there is none
+static int next_column(Generator *G, RowSampler *S)
+{
+	int n = G->n;
+	int i = S->i;
+
+	switch (G->graph)
+	{
+	case RCM_GRAPH_RANDOM:
+		S->j = skip_columns(S, S->j + 1, n, G->p);
+		break;
+
+	case RCM_GRAPH_GRID2D:
+	case RCM_GRAPH_GRID3D:
+	{
+		//! Neighbors at +x, +y and +z, in that (increasing) order
+		int x = i % G->nx;
+		int y = (i / G->nx) % G->ny;
+		int z = i / G->nx / G->ny;
+		int j = -1;
+		while (j < 0 && S->step < 3)
+		{
+			if (S->step == 0 && x + 1 < G->nx)
+				j = i + 1;
+			else if (S->step == 1 && y + 1 < G->ny)
+				j = i + G->nx;
+			else if (S->step == 2 && z + 1 < G->nz)
+				j = i + G->nx * G->ny;
+			S->step++;
+		}
+		S->j = j;
+		break;
+	}
+
+	case RCM_GRAPH_BANDED:
+		//! Every column of the band, then random ones past it
+		if (S->step == 0 && S->j + 1 < n && S->j + 1 <= i + G->bandwidth)
+			S->j++;
+		else
+		{
+			S->step = 1;
+			S->j = skip_columns(S, S->j + 1, n, G->p);
+		}
+		break;
+
+	case RCM_GRAPH_POWER_LAW:
+	{
+		double w = (G->total_weight > 0) ? G->weights[i] / G->total_weight : 0;
+		int j = S->j + 1;
+		if (S->step == 0)
+		{
+			//! The probability of the first column
+			S->p = (j < n) ? fmin(1, w * G->weights[j]) : 0;
+			S->step = 1;
+		}
+
+		while (j < n && S->p > 0)
+		{
+			j = skip_columns(S, j, n, S->p);
+			if (j < 0)
+				break;
+
+			double q = fmin(1, w * G->weights[j]);
+			int accept = uniform(S) * S->p < q;
+			S->p = q;
+			if (accept)
+				break;
+			j++;
+		}
+		S->j = (j < n && S->p > 0) ? j : -1;
+		break;
+	}
+
+	default:
+		S->j = -1;
+	}
+
+	//! Once done, the row stays done
+	if (S->j < 0)
+		S->j = n;
+
+	return (S->j < n) ? S->j : -1;
+}
+
+//! The first column from 'from' on that is drawn with probability p, found
+//! with a single geometric skip instead of a draw per column, or -1
+static int skip_columns(RowSampler *S, int from, int n, double p)
+{
+	if (from >= n || p <= 0)
+		return -1;
+	if (p >= 1)
+		return from;
+
+	double skip = floor(log(uniform(S)) / log1p(-p));
+
+	return (skip < n - from) ? from + (int)skip : -1;
+}
+
+/*
+*************************************************************************
+*    Counter-based random numbers: the 64-bit finalizer of SplitMix64   *
+*    over the key of the row plus the counter, times the golden ratio.  *
+*    It passes BigCrush as a generator, and needs no state but the      *
+*    counter, so that a row is generated without its predecessors       *
+*************************************************************************
+*/
+
+static uint64_t mix64(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+	return x ^ (x >> 31);
+}
+
+//! Uniform in (0, 1], so that its logarithm is finite
+static double uniform(RowSampler *S)
+{
+	uint64_t x = mix64(S->key + ++S->counter * 0x9E3779B97F4A7C15ULL);
+
+	return ((x >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static int compare_int(const void *a, const void *b)
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,158 @@
+/*
+***************************************************
+*    Graph stored in contiguous adjacency arrays    *
+***************************************************
+*/
+
+#include "../inc/rcm.h"
+
+Graph *createGraph(int vertices, RCMOffset edges)
+{
+	Graph *graph = malloc(sizeof(Graph));
+	if (graph == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for graph failed\n\n");
+		return NULL;
+	}
+
+	graph->numVertices = vertices;
+	graph->numEdges = edges;
+	graph->offsets = calloc((size_t)vertices + 1, sizeof(RCMOffset));
+	graph->adjacency = malloc((edges > 0 ? (size_t)edges : 1) * sizeof(int));
+	if (graph->offsets == NULL || graph->adjacency == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for graph arrays failed\n\n");
+		freeGraph(graph);
+		return NULL;
+	}
+
+	return graph;
+}
+
+void freeGraph(Graph *graph)
+{
+	if (graph == NULL)
+		return;
+
+	free(graph->offsets);
+	free(graph->adjacency);
+	free(graph);
+}
+
+/*
+************************************************************************
+*    Build the graph of a dense symmetric matrix in two passes. The    *
+*    first counts the neighbors of every vertex, a prefix sum turns    *
+*    the counts to offsets, and the second writes the neighbors of     *
+*    every vertex to its own part of the adjacency array. Both passes  *
+*    are over independent rows, so they run in parallel                *
+************************************************************************
+*/
+
+Graph *dense_to_graph(int *X, int n)
+{
+	RCMOffset *counts = malloc(((size_t)n + 1) * sizeof(RCMOffset));
+	if (counts == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'counts' failed\n\n");
+		return NULL;
+	}
+
+	counts[0] = 0;
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < n; i++)
+		counts[i + 1] = row_count_nonzeros(X + (size_t)n * i, n, i, NULL);
+
+	for (int i = 0; i < n; i++)
+	{
+		if (counts[i + 1] > RCM_OFFSET_MAX - counts[i])
+		{
+			printf(RED "Error:" RESET_COLOR " The matrix has too many entries for 32-bit row pointers (see RCM_INDEX64)\n\n");
+			free(counts);
+			return NULL;
+		}
+		counts[i + 1] += counts[i];
+	}
+
+	Graph *graph = createGraph(n, counts[n]);
+	if (graph == NULL)
+	{
+		free(counts);
+		return NULL;
+	}
+
+	memcpy(graph->offsets, counts, ((size_t)n + 1) * sizeof(RCMOffset));
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < n; i++)
+		row_gather_nonzeros(X + (size_t)n * i, 0, n, i, graph->adjacency + graph->offsets[i]);
+
+	free(counts);
+
+	return graph;
+}
+
+/*
+*************************************************************************
+*    The graph with vertex i being vertex permutation[i] of the given   *
+*    graph, built in the same two passes (see permute_pattern()).       *
+*    Neighbors are renumbered and every list is kept sorted             *
+*************************************************************************
+*/
+
+Graph *permute_graph(Graph *graph, int *permutation)
+{
+	Graph *permuted = createGraph(graph->numVertices, graph->numEdges);
+	if (permuted == NULL)
+		return NULL;
+
+	if (permute_pattern(graph->numVertices, graph->offsets, graph->adjacency, permutation,
+						permuted->offsets, permuted->adjacency, 1) != 0)
+	{
+		freeGraph(permuted);
+		return NULL;
+	}
+
+	return permuted;
+}
+
+/*
+******************************************************************
+*    Store the graph to the dense n-by-n matrix X, with ones     *
+*    on the diagonal, one row per vertex, in parallel            *
+******************************************************************
+*/
+
+void graph_to_dense(Graph *graph, int *X)
+{
+	int n = graph->numVertices;
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int v = 0; v < n; v++)
+	{
+		int *row = X + (size_t)n * v;
+
+		memset(row, 0, n * sizeof(int));
+		row[v] = 1;
+
+		for (RCMOffset k = graph->offsets[v]; k < graph->offsets[v + 1]; k++)
+			row[graph->adjacency[k]] = 1;
+	}
+}
+
+void printGraph(Graph *graph)
+{
+	for (int v = 0; v < graph->numVertices; v++)
+	{
+		printf("\n Vertex %d\n: ", v);
+
+		for (RCMOffset k = graph->offsets[v]; k < graph->offsets[v + 1]; k++)
+		{
+			printf("%d", graph->adjacency[k]);
+			if (k < graph->offsets[v + 1] - 1)
+				printf(" -> ");
+		}
+		printf("\n");
+	}
+	printf("\n");
+}
@@ -6,6 +6,223 @@
 
 #include "../inc/rcm.h"
 
+//! How the start node of each component is picked
+static RCMStartMode start_mode = RCM_START_MIN_DEGREE;
+
+//! How each component is traversed
+static RCMEngine engine = RCM_ENGINE_QUEUE;
+
+//! Which ordering is computed, and by which implementation
+static RCMOrdering ordering = RCM_ORDERING_RCM;
+static RCMBackend backend = RCM_BACKEND_OPENMP;
+
+static const char *ordering_names[RCM_NUM_ORDERINGS] = {"rcm", "cm", "sloan", "gps"};
+
+/*
+******************************************************************
+*    Choose how the start node of each component is picked       *
+******************************************************************
+*/
+
+void rcm_set_start_mode(RCMStartMode mode)
+{
+	start_mode = mode;
+}
+
+RCMStartMode rcm_get_start_mode(void)
+{
+	return start_mode;
+}
+
+/*
+*************************************************************
+*    Choose how each component is traversed                 *
+*************************************************************
+*/
+
+void rcm_set_engine(RCMEngine mode)
+{
+	engine = mode;
+}
+
+RCMEngine rcm_get_engine(void)
+{
+	return engine;
+}
+
+/*
+*************************************************************
+*    Choose which ordering is computed, and by which        *
+*    implementation                                         *
+*************************************************************
+*/
+
+void rcm_set_ordering(RCMOrdering mode)
+{
+	ordering = mode;
+}
+
+RCMOrdering rcm_get_ordering(void)
+{
+	return ordering;
+}
+
+const char *rcm_ordering_name(RCMOrdering mode)
+{
+	return (mode >= 0 && mode < RCM_NUM_ORDERINGS) ? ordering_names[mode] : "unknown";
+}
+
+int rcm_ordering_from_name(const char *name)
+{
+	for (int o = 0; o < RCM_NUM_ORDERINGS; o++)
+		if (strcmp(name, ordering_names[o]) == 0)
+			return o;
+
+	return -1;
+}
+
+void rcm_set_backend(RCMBackend mode)
+{
+	backend = mode;
+}
+
+RCMBackend rcm_get_backend(void)
+{
+	return backend;
+}
+
+/*
+**********************************
+*    Workspace implementation    *
+**********************************
+*/
+
+Workspace *createWorkspace(size_t capacity)
+{
+	Workspace *W = malloc(sizeof(Workspace));
+	if (W == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for workspace failed\n\n");
+		return NULL;
+	}
+
+	W->capacity = 0;
+	W->top = 0;
+	W->arena = NULL;
+	if (reserveWorkspace(W, capacity) != 0)
+	{
+		free(W);
+		return NULL;
+	}
+
+	return W;
+}
+
+int reserveWorkspace(Workspace *W, size_t capacity)
+{
+	//! It only ever grows, keeping whatever has been taken
+	if (capacity <= W->capacity)
+		return 0;
+
+	int *arena = realloc(W->arena, capacity * sizeof(int));
+	if (arena == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for W->arena failed\n\n");
+		return -1;
+	}
+
+	W->arena = arena;
+	W->capacity = capacity;
+
+	return 0;
+}
+
+int *workspaceAlloc(Workspace *W, size_t count)
+{
+	if (W->top + count > W->capacity)
+	{
+		printf(RED "Error:" RESET_COLOR " Workspace is full\n\n");
+		return NULL;
+	}
+
+	int *ptr = W->arena + W->top;
+	W->top += count;
+
+	return ptr;
+}
+
+size_t workspaceMark(Workspace *W)
+{
+	return W->top;
+}
+
+void workspaceRelease(Workspace *W, size_t mark)
+{
+	W->top = mark;
+}
+
+void freeWorkspace(Workspace *W)
+{
+	if (W == NULL)
+		return;
+
+	free(W->arena);
+	free(W);
+}
+
+/*
+********************************
+*    Context implementation    *
+********************************
+*/
+
+RCMContext *createContext(void)
+{
+	RCMContext *C = malloc(sizeof(RCMContext));
+	if (C == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for context failed\n\n");
+		return NULL;
+	}
+
+	C->workspace = createWorkspace(0);
+	if (C->workspace == NULL)
+	{
+		free(C);
+		return NULL;
+	}
+	C->start_mode = start_mode;
+	C->engine = engine;
+	C->ordering = ordering;
+	C->backend = backend;
+
+	return C;
+}
+
+void freeContext(RCMContext *C)
+{
+	if (C == NULL)
+		return;
+
+	freeWorkspace(C->workspace);
+	free(C);
+}
+
+const char *rcm_status_string(RCMStatus status)
+{
+	switch (status)
+	{
+	case RCM_OK:
+		return "Success";
+	case RCM_ERROR_INVALID_ARGUMENT:
+		return "Invalid argument";
+	case RCM_ERROR_OUT_OF_MEMORY:
+		return "Out of memory";
+	}
+
+	return "Unknown status";
+}
+
 /*
 ************************************************************
 *    Function that reverses the values of a given array    *
@@ -28,12 +245,18 @@ Queue *createQueue(int max_elements)
 {
 	Queue *Q;
 	Q = malloc(sizeof(Queue));
+	if (Q == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for queue failed\n\n");
+		return NULL;
+	}
 
-	Q->elements = malloc(max_elements * sizeof(int));
+	Q->elements = malloc((max_elements > 0 ? max_elements : 1) * sizeof(int));
 	if (Q->elements == NULL)
 	{
 		printf(RED "Error:" RESET_COLOR " Memory allocation for Q->elements failed\n\n");
-		exit(1);
+		free(Q);
+		return NULL;
 	}
 
 	Q->size = 0;
@@ -44,22 +267,22 @@ Queue *createQueue(int max_elements)
 	return Q;
 }
 
-void enqueue(Queue *Q, int element)
+int enqueue(Queue *Q, int element)
 {
 	//! If the queue is full, we cannot push an element
 	//! into it as there is no space for it
 	if (Q->size == Q->capacity)
-		printf("Queue is Full\n");
-	else
-	{
-		Q->size++;
-		Q->rear = Q->rear + 1;
-		if (Q->rear == Q->capacity)
-			Q->rear = 0;
+		return -1;
 
-		//! Insert the element in its rear side
-		Q->elements[Q->rear] = element;
-	}
+	Q->size++;
+	Q->rear = Q->rear + 1;
+	if (Q->rear == Q->capacity)
+		Q->rear = 0;
+
+	//! Insert the element in its rear side
+	Q->elements[Q->rear] = element;
+
+	return 0;
 }
 
 void dequeue(Queue *Q)
@@ -82,7 +305,7 @@ int peek(Queue *Q)
 	if (Q->size == 0)
 	{
 		printf("Queue is Empty\n");
-		exit(0);
+		return -1;
 	}
 
 	//! Return the element which is at the front
@@ -105,6 +328,86 @@ int isFull(Queue *Q)
 		return 0;
 }
 
+void freeQueue(Queue *Q)
+{
+	if (Q == NULL)
+		return;
+
+	free(Q->elements);
+	free(Q);
+}
+
+/*
+***************************************
+*    Start selector implementation    *
+***************************************
+*/
+
+StartSelector *createStartSelector(int *degrees, int n)
+{
+	StartSelector *S = malloc(sizeof(StartSelector));
+	if (S == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for start selector failed\n\n");
+		return NULL;
+	}
+
+	int *order = malloc((n > 0 ? n : 1) * sizeof(int));
+	int *counts = malloc((n + 1) * sizeof(int));
+	if (order == NULL || counts == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for S->order failed\n\n");
+		free(order);
+		free(counts);
+		free(S);
+		return NULL;
+	}
+
+	initStartSelector(S, degrees, n, order, counts);
+
+	free(counts);
+
+	return S;
+}
+
+void initStartSelector(StartSelector *S, int *degrees, int n, int *order, int *counts)
+{
+	S->n = n;
+	S->cursor = 0;
+	S->order = order;
+
+	//! A degree is at most n - 1, so the counters fit in n + 1 slots
+	for (int d = 0; d <= n; d++)
+		counts[d] = 0;
+
+	//! Counting sort, stable, so that equal degrees stay in index order
+	for (int i = 0; i < n; i++)
+		counts[degrees[i] + 1]++;
+	for (int d = 0; d < n; d++)
+		counts[d + 1] += counts[d];
+	for (int i = 0; i < n; i++)
+		S->order[counts[degrees[i]]++] = i;
+}
+
+int nextStartNode(StartSelector *S, int *inserted)
+{
+	//! Nodes are never removed from R, so everything
+	//! before the cursor stays visited
+	while (S->cursor < S->n && inserted[S->order[S->cursor]])
+		S->cursor++;
+
+	return (S->cursor < S->n) ? S->order[S->cursor] : -1;
+}
+
+void freeStartSelector(StartSelector *S)
+{
+	if (S == NULL)
+		return;
+
+	free(S->order);
+	free(S);
+}
+
 /*
 **********************************
 *    QuickSort implementation    *
@@ -152,63 +455,233 @@ void swap(int *a, int *b)
 }
 
 /*
-******************************
-*    Graph Implementation    *
-******************************
+*******************************
+*    Stable sort by degree    *
+*******************************
 */
 
-node *createNode(int v)
+//! Arrays up to this size are sorted with insertion sort
+#define INSERTION_SORT_MAX 16
+
+void degreeSort(int arr1[], int arr2[], int n, int scratch[])
+{
+	if (n <= INSERTION_SORT_MAX)
+	{
+		insertionSort(arr1, arr2, n);
+		return;
+	}
+
+	if (scratch != NULL)
+	{
+		radixSort(arr1, arr2, n, scratch);
+		return;
+	}
+
+	//! Without room for the radix sort, insertion sort is
+	//! slower but just as stable
+	scratch = malloc(n * sizeof(int));
+	if (scratch == NULL)
+	{
+		insertionSort(arr1, arr2, n);
+		return;
+	}
+
+	radixSort(arr1, arr2, n, scratch);
+
+	free(scratch);
+}
+
+void insertionSort(int arr1[], int arr2[], int n)
+{
+	for (int i = 1; i < n; i++)
+	{
+		int element = arr1[i];
+		int key = arr2[element];
+
+		//! Shift the larger elements one place to the right. Equal
+		//! ones stay before it, which keeps the sort stable
+		int j = i - 1;
+		while (j >= 0 && arr2[arr1[j]] > key)
+		{
+			arr1[j + 1] = arr1[j];
+			j--;
+		}
+
+		arr1[j + 1] = element;
+	}
+}
+
+void radixSort(int arr1[], int arr2[], int n, int scratch[])
 {
-	node *newNode = malloc(sizeof(node));
-	newNode->vertex = v;
-	newNode->next = NULL;
+	//! Sort on the distance from the minimum value, so
+	//! that only the bytes that differ need a pass
+	int min = arr2[arr1[0]];
+	int max = min;
+	for (int i = 1; i < n; i++)
+	{
+		int key = arr2[arr1[i]];
+		if (key < min)
+			min = key;
+		if (key > max)
+			max = key;
+	}
+
+	int *src = arr1;
+	int *dst = scratch;
+	unsigned range = max - min;
+
+	for (int shift = 0; shift < 32 && (range >> shift) > 0; shift += 8)
+	{
+		//! Counting sort on the current byte, which is stable
+		int counts[257] = {0};
+		for (int i = 0; i < n; i++)
+			counts[((unsigned)(arr2[src[i]] - min) >> shift & 0xff) + 1]++;
+		for (int b = 0; b < 256; b++)
+			counts[b + 1] += counts[b];
+		for (int i = 0; i < n; i++)
+			dst[counts[(unsigned)(arr2[src[i]] - min) >> shift & 0xff]++] = src[i];
+
+		int *temp = src;
+		src = dst;
+		dst = temp;
+	}
 
-	return newNode;
+	//! After an odd number of passes the result is in scratch
+	if (src != arr1)
+		memcpy(arr1, src, n * sizeof(int));
 }
 
-Graph *createGraph(int vertices)
+/*
+****************************
+*    CSR Implementation    *
+****************************
+*/
+
+CSR *createCSR(int n, RCMOffset nnz)
 {
-	Graph *graph = malloc(sizeof(Graph));
-	graph->numVertices = vertices;
+	CSR *A = malloc(sizeof(CSR));
+	if (A == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for CSR matrix failed\n\n");
+		return NULL;
+	}
 
-	graph->adjLists = malloc(vertices * sizeof(node *));
+	A->n = n;
+	A->nnz = nnz;
+	A->row_ptr = malloc(((size_t)n + 1) * sizeof(RCMOffset));
+	A->col_idx = malloc((nnz > 0 ? (size_t)nnz : 1) * sizeof(int));
+	if (A->row_ptr == NULL || A->col_idx == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for CSR arrays failed\n\n");
+		freeCSR(A);
+		return NULL;
+	}
 
-	for (int i = 0; i < vertices; i++)
-		graph->adjLists[i] = NULL;
+	A->row_ptr[0] = 0;
 
-	return graph;
+	return A;
 }
 
-void addEdge(Graph *graph, int s, int d)
+void freeCSR(CSR *A)
 {
-	//! Add edge from s to d
-	node *newNode = createNode(d);
-	newNode->next = graph->adjLists[s];
-	graph->adjLists[s] = newNode;
+	if (A == NULL)
+		return;
 
-	//! Add edge from d to s
-	newNode = createNode(s);
-	newNode->next = graph->adjLists[d];
-	graph->adjLists[d] = newNode;
+	free(A->row_ptr);
+	free(A->col_idx);
+	free(A);
 }
 
-void printGraph(Graph *graph)
+CSR *dense_to_csr(int *X, int n)
 {
-	for (int v = 0; v < graph->numVertices; v++)
+	//! First pass counts the entries, second pass fills them in
+	size_t nnz = 0;
+	for (size_t i = 0; i < (size_t)n * n; i++)
+		if (X[i])
+			nnz++;
+
+	if (nnz > RCM_OFFSET_MAX)
 	{
-		node *temp = graph->adjLists[v];
-		printf("\n Vertex %d\n: ", v);
+		printf(RED "Error:" RESET_COLOR " The matrix has too many entries for 32-bit row pointers (see RCM_INDEX64)\n\n");
+		return NULL;
+	}
 
-		while (temp)
-		{
-			printf("%d", temp->vertex);
-			temp = temp->next;
-			if (temp)
-				printf(" -> ");
-		}
-		printf("\n");
+	CSR *A = createCSR(n, nnz);
+	if (A == NULL)
+		return NULL;
+
+	RCMOffset k = 0;
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+			if (X[(size_t)n * i + j])
+				A->col_idx[k++] = j;
+
+		A->row_ptr[i + 1] = k;
 	}
-	printf("\n");
+
+	return A;
+}
+
+/*
+******************************************
+*    Bit-packed matrix Implementation    *
+******************************************
+*/
+
+BitMatrix *createBitMatrix(int n)
+{
+	BitMatrix *B = malloc(sizeof(BitMatrix));
+	if (B == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for bit-packed matrix failed\n\n");
+		return NULL;
+	}
+
+	B->n = n;
+	B->words_per_row = (n + 63) / 64;
+	B->bits = calloc((size_t)n * B->words_per_row, sizeof(uint64_t));
+	if (B->bits == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for B->bits failed\n\n");
+		free(B);
+		return NULL;
+	}
+
+	return B;
+}
+
+void freeBitMatrix(BitMatrix *B)
+{
+	if (B == NULL)
+		return;
+
+	free(B->bits);
+	free(B);
+}
+
+BitMatrix *dense_to_bitmatrix(int *X, int n)
+{
+	BitMatrix *B = createBitMatrix(n);
+	if (B == NULL)
+		return NULL;
+
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			if (X[(size_t)n * i + j])
+				bitmatrix_set(B, i, j);
+
+	return B;
+}
+
+void bitmatrix_set(BitMatrix *B, int i, int j)
+{
+	B->bits[(size_t)i * B->words_per_row + j / 64] |= (uint64_t)1 << (j % 64);
+}
+
+int bitmatrix_get(BitMatrix *B, int i, int j)
+{
+	return (B->bits[(size_t)i * B->words_per_row + j / 64] >> (j % 64)) & 1;
 }
 
 /*
@@ -229,10 +702,10 @@ void print_array_2d(int *X, int n)
 	for (int i = 0; i < n; i++)
 	{
 		for (int j = 0; j < n; j++)
-			if (X[n * i + j])
-				printf(GREEN "%d " RESET_COLOR, X[n * i + j]);
+			if (X[(size_t)n * i + j])
+				printf(GREEN "%d " RESET_COLOR, X[(size_t)n * i + j]);
 			else
-				printf(RED "%d " RESET_COLOR, X[n * i + j]);
+				printf(RED "%d " RESET_COLOR, X[(size_t)n * i + j]);
 		printf("\n");
 	}
 	printf("\n");
@@ -248,7 +721,7 @@ int calc_bandwidth(int *X, int n)
 	{
 		temp = 0;
 		for (int j = n - 1; j > i; j--)
-			if (X[n * i + j] != 0)
+			if (X[(size_t)n * i + j] != 0)
 			{
 				temp = j - i;
 				break;
@@ -261,7 +734,7 @@ int calc_bandwidth(int *X, int n)
 
 		temp = 0;
 		for (int j = 0; j < i; j++)
-			if (X[n * i + j] != 0)
+			if (X[(size_t)n * i + j] != 0)
 			{
 				temp = i - j;
 				break;
@@ -0,0 +1,1220 @@
+/*
+*************************************************
+*    Reading and writing matrices from files    *
+*************************************************
+*/
+
+#include <stdint.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../inc/rcm.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//! Magic bytes at the start of every binary CSR file
+static const char CSR_MAGIC[8] = {'R', 'C', 'M', 'C', 'S', 'R', '0', '1'};
+
+//! Magic bytes at the start of every bit-packed matrix file
+static const char BITS_MAGIC[8] = {'R', 'C', 'M', 'B', 'I', 'T', 'S', '1'};
+
+//! Matrices mapped by map_matrix() at most at a time, as far as
+//! advise_mapped() is concerned
+#define MAX_MAPPED 64
+
+/*
+****************************************************************
+*    Header of the binary CSR format. It is followed by the    *
+*    row pointers [n+1], stored as index_bytes (4 or 8) wide   *
+*    integers, and the column indices [nnz] as 4-byte ones     *
+****************************************************************
+*/
+
+typedef struct CSRFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t index_bytes;
+	uint64_t n;
+	uint64_t nnz;
+} CSRFileHeader;
+
+/*
+****************************************************************
+*    Header of the bit-packed format, the same size as that    *
+*    of the binary CSR format. It is followed by the n rows    *
+*    of words_per_row 64-bit words, laid out as in BitMatrix   *
+****************************************************************
+*/
+
+typedef struct BitsFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t word_bytes;
+	uint64_t n;
+	uint64_t words_per_row;
+} BitsFileHeader;
+
+//! The matrices currently mapped, which advise_mapped() looks up
+static MappedMatrix *mapped[MAX_MAPPED];
+
+static char *read_file(const char *filename, size_t *size);
+static const char *skip_line(const char *p, const char *end);
+static const char *parse_int(const char *p, const char *end, long *value);
+static RCMOffset count_entries(const char *p, const char *end);
+static const char *chunk_start(const char *data, const char *end, int t, int num_chunks);
+static int compare_int(const void *a, const void *b);
+static int read_offsets(FILE *fp, RCMOffset *offsets, size_t count, int index_bytes);
+static int write_offsets(FILE *fp, const RCMOffset *offsets, size_t count, int index_bytes);
+static int valid_csr(int n, RCMOffset nnz, const RCMOffset *row_ptr, const int *col_idx);
+static int valid_bits(BitMatrix *B);
+static CSR *build_symmetric_csr(int n, RCMOffset num_entries, int *rows, int *cols);
+static int write_mapped(const char *filename, const char *header, CSR *A, size_t *offsets,
+						char *(*format_row)(CSR *A, int i, char *out));
+static char *format_mtx_row(CSR *A, int i, char *out);
+static char *format_csv_row(CSR *A, int i, char *out);
+static int num_digits(unsigned v);
+static char *put_int(char *out, unsigned v, int digits);
+static int has_suffix(const char *str, const char *suffix);
+static int write_csr_as_bits(const char *filename, CSR *A);
+static int map_csr(MappedMatrix *M, const char *filename);
+static int map_bits(MappedMatrix *M, const char *filename);
+static void advise(const void *start, const void *end, int advice);
+
+/*
+****************************************************************************
+*    Read a Matrix Market file. Only the coordinate format is supported,   *
+*    values (if any) are ignored, and the pattern is symmetrized           *
+****************************************************************************
+*/
+
+CSR *read_mtx(const char *filename)
+{
+	size_t size;
+	char *buffer = read_file(filename, &size);
+	if (buffer == NULL)
+		return NULL;
+
+	const char *p = buffer;
+	const char *end = buffer + size;
+
+	//! Check the banner line
+	if (strncmp(p, "%%MatrixMarket", 14) != 0)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is not a Matrix Market file\n\n", filename);
+		free(buffer);
+		return NULL;
+	}
+	char object[32] = {0}, format[32] = {0};
+	sscanf(p + 14, "%31s %31s", object, format);
+	if (strcmp(object, "matrix") != 0 || strcmp(format, "coordinate") != 0)
+	{
+		printf(RED "Error:" RESET_COLOR " Only 'matrix coordinate' Matrix Market files are supported\n\n");
+		free(buffer);
+		return NULL;
+	}
+
+	//! Skip the banner and the comments that follow it
+	while (p < end && *p == '%')
+		p = skip_line(p, end);
+
+	//! Read the size line
+	long rows = -1, cols = -1, entries = -1;
+	p = parse_int(p, end, &rows);
+	p = parse_int(p, end, &cols);
+	p = parse_int(p, end, &entries);
+	if (p == NULL || rows <= 0 || rows != cols || entries < 0 || rows > INT32_MAX || entries > RCM_OFFSET_MAX / 2)
+	{
+		printf(RED "Error:" RESET_COLOR " Invalid or non-square matrix size in '%s'\n\n", filename);
+		free(buffer);
+		return NULL;
+	}
+	p = skip_line(p, end);
+
+	int n = (int)rows;
+	int *I = malloc((entries > 0 ? (size_t)entries : 1) * sizeof(int));
+	int *J = malloc((entries > 0 ? (size_t)entries : 1) * sizeof(int));
+	if (I == NULL || J == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for the Matrix Market entries failed\n\n");
+		free(buffer);
+		free(I);
+		free(J);
+		return NULL;
+	}
+
+	//! Parse the coordinate section in chunks, one per thread. Each chunk
+	//! starts at a line boundary. The entries of each chunk are counted
+	//! first, so that after a prefix sum every thread knows where to
+	//! write its own entries and the order of the file is preserved
+	int num_chunks = 1;
+#ifdef _OPENMP
+	num_chunks = omp_get_max_threads();
+#endif
+	RCMOffset *offsets = calloc(num_chunks + 1, sizeof(RCMOffset));
+	if (offsets == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'offsets' failed\n\n");
+		free(buffer);
+		free(I);
+		free(J);
+		return NULL;
+	}
+
+	int invalid = 0;
+#pragma omp parallel num_threads(num_chunks)
+	{
+		int t = 0;
+#ifdef _OPENMP
+		t = omp_get_thread_num();
+
+		//! The team may be smaller than asked for (e.g. when nested
+		//! in a parallel region), so there is one chunk per thread of it
+#pragma omp single
+		num_chunks = omp_get_num_threads();
+#endif
+		const char *from = chunk_start(p, end, t, num_chunks);
+		const char *to = chunk_start(p, end, t + 1, num_chunks);
+
+		offsets[t + 1] = count_entries(from, to);
+
+#pragma omp barrier
+#pragma omp single
+		for (int i = 0; i < num_chunks; i++)
+			offsets[i + 1] += offsets[i];
+
+		if (offsets[num_chunks] == entries)
+		{
+			RCMOffset k = offsets[t];
+			const char *q = from;
+			while (q < to)
+			{
+				//! Skip blank lines, exactly as count_entries() does
+				while (q < to && (*q == ' ' || *q == '\t' || *q == '\r'))
+					q++;
+				if (q < to && *q == '\n')
+				{
+					q++;
+					continue;
+				}
+
+				long i = 0, j = 0;
+				q = parse_int(q, to, &i);
+				q = parse_int(q, to, &j);
+				if (q == NULL || i < 1 || i > n || j < 1 || j > n)
+				{
+#pragma omp atomic write
+					invalid = 1;
+					break;
+				}
+
+				I[k] = (int)i - 1;
+				J[k] = (int)j - 1;
+				k++;
+
+				q = skip_line(q, to);
+			}
+		}
+	}
+
+	if (offsets[num_chunks] != entries || invalid)
+	{
+		printf(RED "Error:" RESET_COLOR " Malformed coordinate section in '%s'\n\n", filename);
+		free(offsets);
+		free(buffer);
+		free(I);
+		free(J);
+		return NULL;
+	}
+
+	free(offsets);
+	free(buffer);
+
+	CSR *A = build_symmetric_csr(n, entries, I, J);
+
+	free(I);
+	free(J);
+
+	return A;
+}
+
+/*
+**************************************************
+*    Read and write the binary CSR file format    *
+**************************************************
+*/
+
+int write_csr_binary(const char *filename, CSR *A)
+{
+	FILE *fp = fopen(filename, "wb");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", filename);
+		return -1;
+	}
+
+	CSRFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CSR_MAGIC, sizeof(CSR_MAGIC));
+	header.version = 1;
+	header.index_bytes = (A->nnz > INT32_MAX) ? sizeof(int64_t) : sizeof(int32_t);
+	header.n = A->n;
+	header.nnz = A->nnz;
+
+	int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+			 write_offsets(fp, A->row_ptr, (size_t)A->n + 1, header.index_bytes) == 0 &&
+			 fwrite(A->col_idx, sizeof(int), A->nnz, fp) == (size_t)A->nnz;
+
+	if (fclose(fp) != 0 || !ok)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not write '%s'\n\n", filename);
+		return -1;
+	}
+
+	return 0;
+}
+
+CSR *read_csr_binary(const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s'\n\n", filename);
+		return NULL;
+	}
+
+	CSRFileHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		memcmp(header.magic, CSR_MAGIC, sizeof(CSR_MAGIC)) != 0 ||
+		header.version != 1 || (header.index_bytes != sizeof(int32_t) && header.index_bytes != sizeof(int64_t)) ||
+		header.n > INT32_MAX)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is not a supported binary CSR file\n\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+	if (header.nnz > RCM_OFFSET_MAX)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' has too many entries for 32-bit row pointers (see RCM_INDEX64)\n\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+
+	CSR *A = createCSR((int)header.n, (RCMOffset)header.nnz);
+	if (A == NULL)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	int ok = read_offsets(fp, A->row_ptr, (size_t)A->n + 1, header.index_bytes) == 0 &&
+			 fread(A->col_idx, sizeof(int), A->nnz, fp) == (size_t)A->nnz &&
+			 valid_csr(A->n, A->nnz, A->row_ptr, A->col_idx);
+	fclose(fp);
+
+	if (!ok)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		freeCSR(A);
+		return NULL;
+	}
+
+	return A;
+}
+
+/*
+**********************************************************
+*    Read and write the bit-packed matrix file format    *
+**********************************************************
+*/
+
+int write_bitmatrix_binary(const char *filename, BitMatrix *B)
+{
+	FILE *fp = fopen(filename, "wb");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", filename);
+		return -1;
+	}
+
+	BitsFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BITS_MAGIC, sizeof(BITS_MAGIC));
+	header.version = 1;
+	header.word_bytes = sizeof(uint64_t);
+	header.n = B->n;
+	header.words_per_row = B->words_per_row;
+
+	size_t words = (size_t)B->n * B->words_per_row;
+	int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+			 fwrite(B->bits, sizeof(uint64_t), words, fp) == words;
+
+	if (fclose(fp) != 0 || !ok)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not write '%s'\n\n", filename);
+		return -1;
+	}
+
+	return 0;
+}
+
+BitMatrix *read_bitmatrix_binary(const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s'\n\n", filename);
+		return NULL;
+	}
+
+	BitsFileHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		memcmp(header.magic, BITS_MAGIC, sizeof(BITS_MAGIC)) != 0 ||
+		header.version != 1 || header.word_bytes != sizeof(uint64_t) || header.n > INT32_MAX ||
+		header.words_per_row != (header.n + 63) / 64)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is not a supported bit-packed matrix file\n\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+
+	BitMatrix *B = createBitMatrix((int)header.n);
+	if (B == NULL)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	size_t words = (size_t)B->n * B->words_per_row;
+	int ok = fread(B->bits, sizeof(uint64_t), words, fp) == words && valid_bits(B);
+	fclose(fp);
+
+	if (!ok)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		freeBitMatrix(B);
+		return NULL;
+	}
+
+	return B;
+}
+
+//! The pattern of A, with the diagonal set as in the dense
+//! matrices, packed to bits and written as above
+static int write_csr_as_bits(const char *filename, CSR *A)
+{
+	BitMatrix *B = createBitMatrix(A->n);
+	if (B == NULL)
+		return -1;
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < A->n; i++)
+	{
+		bitmatrix_set(B, i, i);
+		for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+			bitmatrix_set(B, i, A->col_idx[k]);
+	}
+
+	int status = write_bitmatrix_binary(filename, B);
+	freeBitMatrix(B);
+
+	return status;
+}
+
+/*
+*************************************************************************
+*    Memory-mapped input. The file is mapped privately (copy-on-write), *
+*    so nothing is read until it is touched, and the arrays of the      *
+*    matrix point straight into the mapping. The header, the size of    *
+*    the file and the contents are validated as read_csr_binary() and   *
+*    read_bitmatrix_binary() do, in one pass that touches every page    *
+*    of a CSR file but only the last word of every bit-packed row       *
+*************************************************************************
+*/
+
+MappedMatrix *map_matrix(const char *filename, int flags)
+{
+	MappedMatrix *M = calloc(1, sizeof(MappedMatrix));
+	if (M == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for mapped matrix failed\n\n");
+		return NULL;
+	}
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s'\n\n", filename);
+		free(M);
+		return NULL;
+	}
+
+	struct stat st;
+	int found = fstat(fd, &st) == 0;
+	if (found && (size_t)st.st_size < sizeof(CSRFileHeader))
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		close(fd);
+		free(M);
+		return NULL;
+	}
+
+	void *map = found ? mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not map '%s'\n\n", filename);
+		free(M);
+		return NULL;
+	}
+	M->map = map;
+	M->size = st.st_size;
+
+	int status;
+	if (memcmp(map, CSR_MAGIC, sizeof(CSR_MAGIC)) == 0)
+		status = map_csr(M, filename);
+	else if (memcmp(map, BITS_MAGIC, sizeof(BITS_MAGIC)) == 0)
+		status = map_bits(M, filename);
+	else
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is neither a binary CSR nor a bit-packed matrix file\n\n", filename);
+		status = -1;
+	}
+
+	if (status != 0)
+	{
+		munmap(M->map, M->size);
+		free(M->row_ptr);
+		free(M);
+		return NULL;
+	}
+
+#ifdef MADV_HUGEPAGE
+	if (flags & RCM_MAP_HUGE_PAGES)
+		advise(M->map, (char *)M->map + M->size, MADV_HUGEPAGE);
+#endif
+
+	//! Register it for advise_mapped(). If there is no room left,
+	//! it simply gets no hints
+#pragma omp critical(mapped)
+	for (int k = 0; k < MAX_MAPPED; k++)
+		if (mapped[k] == NULL)
+		{
+			mapped[k] = M;
+			break;
+		}
+
+	return M;
+}
+
+void unmap_matrix(MappedMatrix *M)
+{
+	if (M == NULL)
+		return;
+
+#pragma omp critical(mapped)
+	for (int k = 0; k < MAX_MAPPED; k++)
+		if (mapped[k] == M)
+			mapped[k] = NULL;
+
+	munmap(M->map, M->size);
+	free(M->row_ptr);
+	free(M);
+}
+
+//! The degree pass reads the row pointers and then the rest in order,
+//! and everything after it jumps around the matrix
+void advise_mapped(const void *data, RCMAccess access)
+{
+	const char *p = data;
+
+#pragma omp critical(mapped)
+	for (int k = 0; k < MAX_MAPPED; k++)
+	{
+		MappedMatrix *M = mapped[k];
+		if (M != NULL && p >= (char *)M->map && p < (char *)M->map + M->size)
+			advise(p, (char *)M->map + M->size, (access == RCM_ACCESS_RANDOM) ? MADV_RANDOM : MADV_SEQUENTIAL);
+	}
+}
+
+static int map_csr(MappedMatrix *M, const char *filename)
+{
+	CSRFileHeader header;
+	memcpy(&header, M->map, sizeof(header));
+
+	size_t payload = M->size - sizeof(header);
+	if (header.version != 1 || (header.index_bytes != sizeof(int32_t) && header.index_bytes != sizeof(int64_t)) ||
+		header.n > INT32_MAX)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is not a supported binary CSR file\n\n", filename);
+		return -1;
+	}
+	if (header.nnz > RCM_OFFSET_MAX)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' has too many entries for 32-bit row pointers (see RCM_INDEX64)\n\n", filename);
+		return -1;
+	}
+
+	size_t offsets_size = (header.n + 1) * header.index_bytes;
+	if (offsets_size > payload || header.nnz > (payload - offsets_size) / sizeof(int))
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		return -1;
+	}
+
+	int n = (int)header.n;
+	char *offsets = (char *)M->map + sizeof(header);
+	int *col_idx = (int *)(offsets + offsets_size);
+
+	//! Row pointers of another width than RCMOffset are converted, which
+	//! only costs n + 1 of them. Columns are always used in place
+	RCMOffset *row_ptr = (RCMOffset *)offsets;
+	if (header.index_bytes != sizeof(RCMOffset))
+	{
+		row_ptr = M->row_ptr = malloc(((size_t)n + 1) * sizeof(RCMOffset));
+		if (row_ptr == NULL)
+		{
+			printf(RED "Error:" RESET_COLOR " Memory allocation for 'row_ptr' failed\n\n");
+			return -1;
+		}
+
+		int bad = 0;
+#pragma omp parallel for schedule(static) reduction(+ : bad)
+		for (int i = 0; i <= n; i++)
+		{
+			int64_t value = (header.index_bytes == sizeof(int32_t)) ? ((int32_t *)offsets)[i] : ((int64_t *)offsets)[i];
+			if (value < 0 || value > RCM_OFFSET_MAX)
+				bad++;
+			row_ptr[i] = (RCMOffset)value;
+		}
+		if (bad)
+		{
+			printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+			return -1;
+		}
+	}
+	else
+		advise(offsets, offsets + offsets_size, MADV_WILLNEED);
+
+	advise(col_idx, col_idx + header.nnz, MADV_SEQUENTIAL);
+
+	if (!valid_csr(n, (RCMOffset)header.nnz, row_ptr, col_idx))
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		return -1;
+	}
+
+	M->csr.n = n;
+	M->csr.nnz = (RCMOffset)header.nnz;
+	M->csr.row_ptr = row_ptr;
+	M->csr.col_idx = col_idx;
+
+	return 0;
+}
+
+static int map_bits(MappedMatrix *M, const char *filename)
+{
+	BitsFileHeader header;
+	memcpy(&header, M->map, sizeof(header));
+
+	size_t payload = M->size - sizeof(header);
+	if (header.version != 1 || header.word_bytes != sizeof(uint64_t) || header.n > INT32_MAX ||
+		header.words_per_row != (header.n + 63) / 64)
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is not a supported bit-packed matrix file\n\n", filename);
+		return -1;
+	}
+	if (header.n * header.words_per_row > payload / sizeof(uint64_t))
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		return -1;
+	}
+
+	M->is_bitmatrix = 1;
+	M->bitmatrix.n = (int)header.n;
+	M->bitmatrix.words_per_row = (int)header.words_per_row;
+	M->bitmatrix.bits = (uint64_t *)((char *)M->map + sizeof(header));
+
+	if (!valid_bits(&M->bitmatrix))
+	{
+		printf(RED "Error:" RESET_COLOR " '%s' is truncated or corrupted\n\n", filename);
+		return -1;
+	}
+
+	advise(M->bitmatrix.bits, (char *)M->map + M->size, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+//! madvise() from the page of start to end. Hints are only hints, so
+//! a kernel that does not take one (e.g. huge pages of a file system
+//! without them) changes nothing
+static void advise(const void *start, const void *end, int advice)
+{
+	uintptr_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t from = (uintptr_t)start & ~(page - 1);
+
+	if ((uintptr_t)end > from)
+		madvise((void *)from, (uintptr_t)end - from, advice);
+}
+
+/*
+*************************************************************************
+*    Text writers. The length of every row of the file is known in     *
+*    advance, so the lengths are prefix-summed to the offset of every   *
+*    row, the file is sized once and mapped to memory, and all rows     *
+*    are formatted straight into it in parallel                         *
+*************************************************************************
+*/
+
+int write_mtx(const char *filename, CSR *A)
+{
+	size_t *offsets = malloc((A->n + 1) * sizeof(size_t));
+	if (offsets == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'offsets' failed\n\n");
+		return -1;
+	}
+
+	//! Only the lower triangle is stored, one "i j" line per entry
+	long long entries = 0;
+	offsets[0] = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+ : entries)
+	for (int i = 0; i < A->n; i++)
+	{
+		int row_digits = num_digits(i + 1);
+		size_t length = 0;
+		for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+			if (A->col_idx[k] <= i)
+			{
+				length += row_digits + num_digits(A->col_idx[k] + 1) + 2;
+				entries++;
+			}
+
+		offsets[i + 1] = length;
+	}
+
+	for (int i = 0; i < A->n; i++)
+		offsets[i + 1] += offsets[i];
+
+	char header[128];
+	snprintf(header, sizeof(header), "%%%%MatrixMarket matrix coordinate pattern symmetric\n%d %d %lld\n",
+			 A->n, A->n, entries);
+
+	int status = write_mapped(filename, header, A, offsets, format_mtx_row);
+	free(offsets);
+
+	return status;
+}
+
+int write_dense_csv(const char *filename, CSR *A)
+{
+	size_t *offsets = malloc((A->n + 1) * sizeof(size_t));
+	if (offsets == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'offsets' failed\n\n");
+		return -1;
+	}
+
+	//! Every row is n digits, n-1 commas and a newline
+	for (int i = 0; i <= A->n; i++)
+		offsets[i] = (size_t)2 * A->n * i;
+
+	int status = write_mapped(filename, "", A, offsets, format_csv_row);
+	free(offsets);
+
+	return status;
+}
+
+int write_permutation(const char *filename, const int *permutation, int n)
+{
+	FILE *fp = fopen(filename, "wb");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", filename);
+		return -1;
+	}
+
+	int ok = fwrite(permutation, sizeof(int), n, fp) == (size_t)n;
+
+	if (fclose(fp) != 0 || !ok)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not write '%s'\n\n", filename);
+		return -1;
+	}
+
+	return 0;
+}
+
+CSR *read_matrix(const char *filename)
+{
+	if (has_suffix(filename, ".mtx"))
+		return read_mtx(filename);
+
+	return read_csr_binary(filename);
+}
+
+//! One file per thread, with dynamic scheduling as their sizes differ.
+//! Each file is then parsed by its thread alone
+int read_matrices(char **filenames, int count, CSR **matrices)
+{
+	int failed = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : failed)
+	for (int k = 0; k < count; k++)
+	{
+		matrices[k] = read_matrix(filenames[k]);
+		if (matrices[k] == NULL)
+			failed++;
+	}
+
+	return failed;
+}
+
+int write_matrix(const char *filename, CSR *A)
+{
+	if (has_suffix(filename, ".mtx"))
+		return write_mtx(filename, A);
+	if (has_suffix(filename, ".csv"))
+		return write_dense_csv(filename, A);
+	if (has_suffix(filename, ".bits"))
+		return write_csr_as_bits(filename, A);
+
+	return write_csr_binary(filename, A);
+}
+
+//! Write the header and then row i of A at offsets[i] after it. The
+//! space is reserved before mapping, so that a full disk is reported
+//! here instead of as a fault while writing to the mapping
+static int write_mapped(const char *filename, const char *header, CSR *A, size_t *offsets,
+						char *(*format_row)(CSR *A, int i, char *out))
+{
+	size_t header_length = strlen(header);
+	size_t size = header_length + offsets[A->n];
+
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", filename);
+		return -1;
+	}
+
+	if (size == 0)
+		return close(fd);
+
+	char *map = MAP_FAILED;
+	if (posix_fallocate(fd, 0, size) == 0)
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not write '%s'\n\n", filename);
+		close(fd);
+		return -1;
+	}
+
+	memcpy(map, header, header_length);
+	char *body = map + header_length;
+
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < A->n; i++)
+		format_row(A, i, body + offsets[i]);
+
+	int ok = munmap(map, size) == 0;
+	if (close(fd) != 0 || !ok)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not write '%s'\n\n", filename);
+		return -1;
+	}
+
+	return 0;
+}
+
+static char *format_mtx_row(CSR *A, int i, char *out)
+{
+	int row_digits = num_digits(i + 1);
+	for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+	{
+		int j = A->col_idx[k];
+		if (j > i)
+			continue;
+
+		out = put_int(out, i + 1, row_digits);
+		*out++ = ' ';
+		out = put_int(out, j + 1, num_digits(j + 1));
+		*out++ = '\n';
+	}
+
+	return out;
+}
+
+//! Ones on the diagonal and the entries of the row, as graph_to_dense()
+static char *format_csv_row(CSR *A, int i, char *out)
+{
+	int n = A->n;
+	for (int j = 0; j < n; j++)
+	{
+		out[2 * j] = '0';
+		out[2 * j + 1] = ',';
+	}
+	out[2 * n - 1] = '\n';
+
+	out[2 * i] = '1';
+	for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+		out[2 * A->col_idx[k]] = '1';
+
+	return out + 2 * n;
+}
+
+static int num_digits(unsigned v)
+{
+	int digits = 1;
+	while (v >= 10)
+	{
+		v /= 10;
+		digits++;
+	}
+
+	return digits;
+}
+
+//! Write v with exactly the given number of digits, last digit first
+static char *put_int(char *out, unsigned v, int digits)
+{
+	for (int d = digits - 1; d >= 0; d--)
+	{
+		out[d] = '0' + v % 10;
+		v /= 10;
+	}
+
+	return out + digits;
+}
+
+static int has_suffix(const char *str, const char *suffix)
+{
+	size_t len = strlen(str);
+	size_t suffix_len = strlen(suffix);
+
+	return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+/*
+*****************************************************************
+*    Build a CSR matrix from a list of coordinates, adding     *
+*    the transpose of every entry, so that the pattern is      *
+*    symmetric. Columns are sorted and duplicates are removed  *
+*****************************************************************
+*/
+
+static CSR *build_symmetric_csr(int n, RCMOffset num_entries, int *rows, int *cols)
+{
+	RCMOffset *row_ptr = calloc((size_t)n + 1, sizeof(RCMOffset));
+	RCMOffset *fill = malloc(((size_t)n > 0 ? (size_t)n : 1) * sizeof(RCMOffset));
+	if (row_ptr == NULL || fill == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'row_ptr' failed\n\n");
+		free(row_ptr);
+		free(fill);
+		return NULL;
+	}
+
+	//! Count the entries of every row, both (i,j) and (j,i)
+#pragma omp parallel for schedule(static)
+	for (RCMOffset k = 0; k < num_entries; k++)
+	{
+#pragma omp atomic
+		row_ptr[rows[k] + 1]++;
+		if (rows[k] != cols[k])
+		{
+#pragma omp atomic
+			row_ptr[cols[k] + 1]++;
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+		row_ptr[i + 1] += row_ptr[i];
+
+	RCMOffset total = row_ptr[n];
+	int *col_idx = malloc((total > 0 ? (size_t)total : 1) * sizeof(int));
+	if (col_idx == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'col_idx' failed\n\n");
+		free(row_ptr);
+		free(fill);
+		return NULL;
+	}
+
+	//! Scatter the entries to their rows
+	memcpy(fill, row_ptr, n * sizeof(RCMOffset));
+#pragma omp parallel for schedule(static)
+	for (RCMOffset k = 0; k < num_entries; k++)
+	{
+		RCMOffset pos;
+#pragma omp atomic capture
+		pos = fill[rows[k]]++;
+		col_idx[pos] = cols[k];
+
+		if (rows[k] != cols[k])
+		{
+#pragma omp atomic capture
+			pos = fill[cols[k]]++;
+			col_idx[pos] = rows[k];
+		}
+	}
+
+	//! Sort every row and drop duplicates, keeping the new length of each
+	//! row in fill. The scatter order above does not matter after sorting
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < n; i++)
+	{
+		int *row = col_idx + row_ptr[i];
+		int len = row_ptr[i + 1] - row_ptr[i];
+
+		qsort(row, len, sizeof(int), compare_int);
+
+		int unique = 0;
+		for (int k = 0; k < len; k++)
+			if (unique == 0 || row[k] != row[unique - 1])
+				row[unique++] = row[k];
+
+		fill[i] = unique;
+	}
+
+	//! Compact the rows into the final matrix
+	RCMOffset nnz = 0;
+	for (int i = 0; i < n; i++)
+		nnz += fill[i];
+
+	CSR *A = createCSR(n, nnz);
+	if (A == NULL)
+	{
+		free(row_ptr);
+		free(fill);
+		free(col_idx);
+		return NULL;
+	}
+
+	for (int i = 0; i < n; i++)
+		A->row_ptr[i + 1] = A->row_ptr[i] + fill[i];
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		memcpy(A->col_idx + A->row_ptr[i], col_idx + row_ptr[i], fill[i] * sizeof(int));
+
+	free(row_ptr);
+	free(fill);
+	free(col_idx);
+
+	return A;
+}
+
+/*
+**************************
+*    Parsing helpers     *
+**************************
+*/
+
+static char *read_file(const char *filename, size_t *size)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s'\n\n", filename);
+		return NULL;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	long length = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	char *buffer = malloc(length + 1);
+	if (buffer == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for the contents of '%s' failed\n\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+
+	*size = fread(buffer, 1, length, fp);
+	buffer[*size] = '\0';
+	fclose(fp);
+
+	return buffer;
+}
+
+//! Return a pointer to the start of the next line
+static const char *skip_line(const char *p, const char *end)
+{
+	while (p < end && *p != '\n')
+		p++;
+
+	return (p < end) ? p + 1 : end;
+}
+
+//! Parse a non-negative integer, skipping leading blanks. Returns
+//! NULL (and leaves value untouched) if there is no number on the line
+static const char *parse_int(const char *p, const char *end, long *value)
+{
+	if (p == NULL)
+		return NULL;
+
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	if (p == end || !isdigit((unsigned char)*p))
+		return NULL;
+
+	long v = 0;
+	while (p < end && isdigit((unsigned char)*p))
+		v = 10 * v + (*p++ - '0');
+
+	*value = v;
+
+	return p;
+}
+
+//! Count the lines that hold an entry (skipping blank lines)
+static RCMOffset count_entries(const char *p, const char *end)
+{
+	RCMOffset count = 0;
+	while (p < end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+		if (p < end && *p != '\n')
+			count++;
+
+		p = skip_line(p, end);
+	}
+
+	return count;
+}
+
+//! Start of chunk t out of num_chunks, moved forward to a line boundary
+static const char *chunk_start(const char *data, const char *end, int t, int num_chunks)
+{
+	if (t == 0)
+		return data;
+	if (t == num_chunks)
+		return end;
+
+	const char *p = data + (end - data) / num_chunks * t;
+
+	return (p[-1] == '\n') ? p : skip_line(p, end);
+}
+
+static int compare_int(const void *a, const void *b)
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+***************************************************************
+*    Row pointers are stored 4 bytes wide when they fit and    *
+*    8 otherwise, whatever the width of RCMOffset, converted   *
+*    through a small buffer                                    *
+***************************************************************
+*/
+
+#define OFFSETS_BLOCK 4096
+
+static int read_offsets(FILE *fp, RCMOffset *offsets, size_t count, int index_bytes)
+{
+	if (index_bytes == sizeof(RCMOffset))
+		return (fread(offsets, sizeof(RCMOffset), count, fp) == count) ? 0 : -1;
+
+	int32_t narrow[OFFSETS_BLOCK];
+	int64_t wide[OFFSETS_BLOCK];
+	void *block = (index_bytes == sizeof(int32_t)) ? (void *)narrow : (void *)wide;
+	for (size_t i = 0; i < count; i += OFFSETS_BLOCK)
+	{
+		size_t length = (count - i < OFFSETS_BLOCK) ? count - i : OFFSETS_BLOCK;
+		if (fread(block, index_bytes, length, fp) != length)
+			return -1;
+
+		for (size_t k = 0; k < length; k++)
+		{
+			int64_t value = (index_bytes == sizeof(int32_t)) ? narrow[k] : wide[k];
+			if (value < 0 || value > RCM_OFFSET_MAX)
+				return -1;
+			offsets[i + k] = (RCMOffset)value;
+		}
+	}
+
+	return 0;
+}
+
+static int write_offsets(FILE *fp, const RCMOffset *offsets, size_t count, int index_bytes)
+{
+	if (index_bytes == sizeof(RCMOffset))
+		return (fwrite(offsets, sizeof(RCMOffset), count, fp) == count) ? 0 : -1;
+
+	int32_t narrow[OFFSETS_BLOCK];
+	int64_t wide[OFFSETS_BLOCK];
+	void *block = (index_bytes == sizeof(int32_t)) ? (void *)narrow : (void *)wide;
+	for (size_t i = 0; i < count; i += OFFSETS_BLOCK)
+	{
+		size_t length = (count - i < OFFSETS_BLOCK) ? count - i : OFFSETS_BLOCK;
+		for (size_t k = 0; k < length; k++)
+			if (index_bytes == sizeof(int32_t))
+				narrow[k] = (int32_t)offsets[i + k];
+			else
+				wide[k] = offsets[i + k];
+
+		if (fwrite(block, index_bytes, length, fp) != length)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+****************************************************************
+*    Whether the arrays read from a file make a CSR matrix     *
+*    that is safe to traverse: row pointers from 0 to nnz,     *
+*    never decreasing, and every column index in [0, n)        *
+****************************************************************
+*/
+
+static int valid_csr(int n, RCMOffset nnz, const RCMOffset *row_ptr, const int *col_idx)
+{
+	if (row_ptr[0] != 0 || row_ptr[n] != nnz)
+		return 0;
+
+	int bad = 0;
+#pragma omp parallel for schedule(static) reduction(+ : bad)
+	for (int i = 0; i < n; i++)
+		if (row_ptr[i] > row_ptr[i + 1])
+			bad++;
+
+#pragma omp parallel for schedule(static) reduction(+ : bad)
+	for (RCMOffset k = 0; k < nnz; k++)
+		if (col_idx[k] < 0 || col_idx[k] >= n)
+			bad++;
+
+	return bad == 0;
+}
+
+//! Whether no row of a bit-packed matrix has a bit set past column
+//! n - 1, in the padding of its last word, which the traversal would
+//! take for a neighbor
+static int valid_bits(BitMatrix *B)
+{
+	if (B->n % 64 == 0)
+		return 1;
+
+	uint64_t padding = ~0ULL << (B->n % 64);
+	int bad = 0;
+#pragma omp parallel for schedule(static) reduction(+ : bad)
+	for (int i = 0; i < B->n; i++)
+		if (B->bits[(size_t)i * B->words_per_row + B->words_per_row - 1] & padding)
+			bad++;
+
+	return bad == 0;
+}
@@ -0,0 +1,295 @@
+/*
+*********************************************************
+*    Vectorized kernels over the rows of dense input    *
+*********************************************************
+*/
+
+#include "../inc/rcm.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef int (*count_fn)(const int *row, int n);
+typedef int (*last_fn)(const int *row, int n);
+typedef int (*gather_fn)(const int *row, int from, int to, int skip, int *neighbors);
+
+static int count_resolve(const int *row, int n);
+static int last_resolve(const int *row, int n);
+static int gather_resolve(const int *row, int from, int to, int skip, int *neighbors);
+
+//! The kernels in use. They start at a resolver, which picks the best
+//! version for this CPU on the first call and replaces itself with it
+static count_fn count_kernel = count_resolve;
+static last_fn last_kernel = last_resolve;
+static gather_fn gather_kernel = gather_resolve;
+
+/*
+***********************************************
+*    Functions exported through the header    *
+***********************************************
+*/
+
+int row_count_nonzeros(const int *row, int n, int skip, int *last)
+{
+	int count = count_kernel(row, n);
+	if (skip >= 0 && skip < n && row[skip])
+		count--;
+
+	if (last != NULL)
+	{
+		//! The diagonal is not a neighbor, so if it happens to be the
+		//! last nonzero, look for the one before it
+		int j = last_kernel(row, n);
+		if (j == skip && j >= 0)
+			j = last_kernel(row, skip);
+
+		*last = (j < 0) ? 0 : j;
+	}
+
+	return count;
+}
+
+int row_gather_nonzeros(const int *row, int from, int to, int skip, int *neighbors)
+{
+	return gather_kernel(row, from, to, skip, neighbors);
+}
+
+/*
+*************************
+*    Scalar versions    *
+*************************
+*/
+
+static int count_scalar(const int *row, int n)
+{
+	int count = 0;
+	for (int j = 0; j < n; j++)
+		count += (row[j] != 0);
+
+	return count;
+}
+
+static int last_scalar(const int *row, int n)
+{
+	for (int j = n - 1; j >= 0; j--)
+		if (row[j])
+			return j;
+
+	return -1;
+}
+
+static int gather_scalar(const int *row, int from, int to, int skip, int *neighbors)
+{
+	int count = 0;
+	for (int j = from; j < to; j++)
+		if (row[j] && j != skip)
+			neighbors[count++] = j;
+
+	return count;
+}
+
+#ifdef X86_KERNELS
+
+/*
+***********************
+*    AVX2 versions    *
+***********************
+*/
+
+__attribute__((target("avx2"))) static int count_avx2(const int *row, int n)
+{
+	//! Every lane counts the zeros it meets (compare gives -1 per zero)
+	__m256i zero = _mm256_setzero_si256();
+	__m256i zeros = _mm256_setzero_si256();
+	int j = 0;
+	for (; j + 8 <= n; j += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(row + j));
+		zeros = _mm256_sub_epi32(zeros, _mm256_cmpeq_epi32(v, zero));
+	}
+
+	int lanes[8];
+	_mm256_storeu_si256((__m256i *)lanes, zeros);
+	int count = j;
+	for (int l = 0; l < 8; l++)
+		count -= lanes[l];
+
+	return count + count_scalar(row + j, n - j);
+}
+
+__attribute__((target("avx2"))) static int last_avx2(const int *row, int n)
+{
+	int j = n;
+	for (; j % 8; j--)
+		if (row[j - 1])
+			return j - 1;
+
+	__m256i zero = _mm256_setzero_si256();
+	for (; j >= 8; j -= 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(row + j - 8));
+		int nonzero = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero))) & 0xff;
+		if (nonzero)
+			return j - 8 + 31 - __builtin_clz(nonzero);
+	}
+
+	return -1;
+}
+
+__attribute__((target("avx2"))) static int gather_avx2(const int *row, int from, int to, int skip, int *neighbors)
+{
+	__m256i zero = _mm256_setzero_si256();
+	int count = 0;
+	int j = from;
+	for (; j + 8 <= to; j += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(row + j));
+		unsigned nonzero = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero))) & 0xff;
+		if (skip >= j && skip < j + 8)
+			nonzero &= ~(1u << (skip - j));
+
+		while (nonzero)
+		{
+			neighbors[count++] = j + __builtin_ctz(nonzero);
+			nonzero &= nonzero - 1;
+		}
+	}
+
+	return count + gather_scalar(row, j, to, skip, neighbors + count);
+}
+
+/*
+**************************
+*    AVX-512 versions    *
+**************************
+*/
+
+__attribute__((target("avx512f"))) static int count_avx512(const int *row, int n)
+{
+	int count = 0;
+	int j = 0;
+	for (; j + 16 <= n; j += 16)
+	{
+		__m512i v = _mm512_loadu_si512(row + j);
+		count += __builtin_popcount(_mm512_test_epi32_mask(v, v));
+	}
+
+	return count + count_scalar(row + j, n - j);
+}
+
+__attribute__((target("avx512f"))) static int last_avx512(const int *row, int n)
+{
+	int j = n;
+	for (; j % 16; j--)
+		if (row[j - 1])
+			return j - 1;
+
+	for (; j >= 16; j -= 16)
+	{
+		__m512i v = _mm512_loadu_si512(row + j - 16);
+		__mmask16 nonzero = _mm512_test_epi32_mask(v, v);
+		if (nonzero)
+			return j - 16 + 31 - __builtin_clz(nonzero);
+	}
+
+	return -1;
+}
+
+__attribute__((target("avx512f"))) static int gather_avx512(const int *row, int from, int to, int skip, int *neighbors)
+{
+	//! Column indices of the 16 lanes, advanced by 16 every step, are
+	//! compressed to the nonzero lanes and stored contiguously
+	__m512i columns = _mm512_add_epi32(_mm512_set1_epi32(from),
+									   _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+	__m512i step = _mm512_set1_epi32(16);
+	int count = 0;
+	int j = from;
+	for (; j + 16 <= to; j += 16)
+	{
+		__m512i v = _mm512_loadu_si512(row + j);
+		__mmask16 nonzero = _mm512_test_epi32_mask(v, v);
+		if (skip >= j && skip < j + 16)
+			nonzero &= ~(1u << (skip - j));
+
+		_mm512_mask_compressstoreu_epi32(neighbors + count, nonzero, columns);
+		count += __builtin_popcount(nonzero);
+		columns = _mm512_add_epi32(columns, step);
+	}
+
+	return count + gather_scalar(row, j, to, skip, neighbors + count);
+}
+
+#endif
+
+/*
+*********************************
+*    Runtime CPU dispatching    *
+*********************************
+*/
+
+static void select_kernels(void)
+{
+	count_fn count = count_scalar;
+	last_fn last = last_scalar;
+	gather_fn gather = gather_scalar;
+
+#ifdef X86_KERNELS
+	__builtin_cpu_init();
+	if (getenv("RCM_NO_SIMD") == NULL)
+	{
+		if (__builtin_cpu_supports("avx512f"))
+		{
+			count = count_avx512;
+			last = last_avx512;
+			gather = gather_avx512;
+		}
+		else if (__builtin_cpu_supports("avx2"))
+		{
+			count = count_avx2;
+			last = last_avx2;
+			gather = gather_avx2;
+		}
+	}
+#endif
+
+	//! Every thread that gets here stores the same values, so
+	//! a race between threads calling in at once is harmless
+	count_kernel = count;
+	last_kernel = last;
+	gather_kernel = gather;
+}
+
+const char *row_kernels_name(void)
+{
+	if (count_kernel == count_resolve)
+		select_kernels();
+
+#ifdef X86_KERNELS
+	if (count_kernel == count_avx512)
+		return "avx512";
+	if (count_kernel == count_avx2)
+		return "avx2";
+#endif
+
+	return "scalar";
+}
+
+static int count_resolve(const int *row, int n)
+{
+	select_kernels();
+	return count_kernel(row, n);
+}
+
+static int last_resolve(const int *row, int n)
+{
+	select_kernels();
+	return last_kernel(row, n);
+}
+
+static int gather_resolve(const int *row, int from, int to, int skip, int *neighbors)
+{
+	select_kernels();
+	return gather_kernel(row, from, to, skip, neighbors);
+}
@@ -0,0 +1,96 @@
+/*
+*****************************************************
+*    Bandwidth, profile and wavefront of a matrix    *
+*****************************************************
+*/
+
+#include "../inc/rcm.h"
+
+/*
+*************************************************************************
+*    Every row is visited once, in parallel, so the cost is O(n + nnz)  *
+*    instead of the O(n^2) of a scan of the dense matrix. The row i     *
+*    of the (permuted) matrix has its envelope from its first column    *
+*    f_i (the diagonal if there is none before it) to the diagonal,     *
+*    and is active from step f_i to step i. Its wavefront is found      *
+*    by marking where each envelope starts and ends, and summing        *
+*************************************************************************
+*/
+
+int calc_metrics_csr(const RCMOffset *row_ptr, const int *col_idx, int n, const int *permutation, Metrics *M)
+{
+	int *inverse = NULL;
+	if (permutation != NULL)
+	{
+		inverse = inverse_permutation(permutation, n);
+		if (inverse == NULL)
+			return -1;
+	}
+
+	int *active = calloc(n + 1, sizeof(int)); // +1 where the envelope of a row starts, -1 after it ends
+	if (active == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'active' failed\n\n");
+		free(inverse);
+		return -1;
+	}
+
+	int lower = 0; // max i - j
+	int upper = 0; // max j - i
+	long long profile = 0;
+	int histogram[METRICS_BINS] = {0};
+
+#pragma omp parallel for schedule(dynamic, 256) reduction(max : lower, upper) reduction(+ : profile, histogram[:METRICS_BINS])
+	for (int r = 0; r < n; r++)
+	{
+		//! Position of row r (and of its columns) in the permuted matrix
+		int i = (inverse != NULL) ? inverse[r] : r;
+		int first = i;
+
+		for (RCMOffset k = row_ptr[r]; k < row_ptr[r + 1]; k++)
+		{
+			int j = (inverse != NULL) ? inverse[col_idx[k]] : col_idx[k];
+			if (i - j > lower)
+				lower = i - j;
+			if (j - i > upper)
+				upper = j - i;
+			if (j < first)
+				first = j;
+		}
+
+		//! Bin 0 holds the rows of bandwidth 0, bin b those in [2^(b-1), 2^b)
+		int row_bandwidth = i - first;
+		profile += row_bandwidth;
+		histogram[row_bandwidth ? 32 - __builtin_clz(row_bandwidth) : 0]++;
+
+#pragma omp atomic
+		active[first]++;
+#pragma omp atomic
+		active[i + 1]--;
+	}
+
+	int wavefront = 0;
+	int max_wavefront = 0;
+	double sum_of_squares = 0;
+	for (int i = 0; i < n; i++)
+	{
+		wavefront += active[i];
+		if (wavefront > max_wavefront)
+			max_wavefront = wavefront;
+		sum_of_squares += (double)wavefront * wavefront;
+	}
+
+	M->bandwidth = lower + upper + 1;
+	M->lower_bandwidth = lower;
+	M->upper_bandwidth = upper;
+	M->profile = profile;
+	M->max_wavefront = max_wavefront;
+	M->mean_wavefront = (n > 0) ? (double)(profile + n) / n : 0;
+	M->rms_wavefront = (n > 0) ? sqrt(sum_of_squares / n) : 0;
+	memcpy(M->histogram, histogram, sizeof(histogram));
+
+	free(inverse);
+	free(active);
+
+	return 0;
+}
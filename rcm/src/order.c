@@ -0,0 +1,688 @@
+/*
+****************************************************
+*    Orderings from the ends of a pseudo-diameter  *
+*    of every component: Sloan's and GPS           *
+****************************************************
+*/
+
+#include <limits.h>
+#include "order.h"
+#include "stats.h"
+
+//! Weights of the distance to the end node and of the degree in the
+//! priority of a node in Sloan's algorithm, the ones Sloan proposed
+#define SLOAN_DISTANCE_WEIGHT 1
+#define SLOAN_DEGREE_WEIGHT 2
+
+//! Status of a node in Sloan's algorithm
+typedef enum Status
+{
+	INACTIVE,  // not reached yet (0, so that nextStartNode() may take it)
+	PREACTIVE, // neighbor of an active node
+	ACTIVE,	   // neighbor of a numbered node
+	POSTACTIVE // numbered
+} Status;
+
+//! A pseudo-diameter of a component and the level
+//! structures rooted at its ends, along with their working arrays
+typedef struct Diameter
+{
+	int v;			 // start
+	int u;			 // end
+	int depth;		 // index of the last level of both structures
+	int width_v;	 // most nodes in a level rooted at v
+	int width_u;	 // most nodes in a level rooted at u
+	int num_nodes;	 // nodes of the component
+	int *level_v;	 // level of each node rooted at v (-1 if none)
+	int *level_u;	 // level of each node rooted at u (-1 if none)
+	int *nodes;		 // nodes of the component, level by level from u
+	int *candidates; // nodes of the last level rooted at v
+	int *neighbors;	 // neighbors of a single node
+	int *scratch;	 // sorting space
+} Diameter;
+
+//! Nodes queued by Sloan's algorithm, highest priority first
+typedef struct Heap
+{
+	int size;
+	int *nodes;	   // binary max-heap of the nodes
+	int *position; // position of each node in it (-1 if none)
+	int *priority; // priority of each node
+} Heap;
+
+//! The combined level structure of GPS, along with its working arrays
+typedef struct Levels
+{
+	int *level;	  // level of each node (-1 if not placed yet)
+	int *members; // nodes of every part, then of every level
+	int *starts;  // first member of every part, then of every level [n+1]
+	int *parts;	  // parts in decreasing order of size
+	int *keys;	  // sort key of every part
+	int *widths;  // nodes placed in every level [n+1]
+	int *high;	  // nodes of a part in every level rooted at v [n+1]
+	int *low;	  // and rooted at u, counted from v's side [n+1]
+} Levels;
+
+static int max_degree_of(int *degrees, int n);
+static void init_diameter(Diameter *D, Workspace *W, int n, int max_degree);
+static void pseudo_diameter(void *A, int n, int *degrees, gather_fn gather, int root, Diameter *D);
+static int level_structure(void *A, int n, int *degrees, gather_fn gather, int root,
+						   int *level, int *nodes, int *neighbors, int *num_nodes, int *width);
+static void clear_levels(int *level, int *nodes, int num_nodes);
+static void raise_priority(Heap *H, int *status, int node);
+static void heap_push(Heap *H, int node);
+static int heap_pop(Heap *H);
+static void sift_up(Heap *H, int i);
+static void sift_down(Heap *H, int i);
+static int heap_before(Heap *H, int a, int b);
+static int combine_levels(void *A, int n, int *degrees, gather_fn gather, Diameter *D, Levels *L);
+static int number_levels(void *A, int n, int *degrees, gather_fn gather, Diameter *D, Levels *L,
+						 int root, int *numbered, int *permutation, int count);
+static int number_neighbors(void *A, int n, int *degrees, gather_fn gather, Diameter *D, int *level,
+							int node, int l, int *numbered, int *permutation, int count);
+
+/*
+**************************************************************************
+*    Sloan's algorithm. Every component is numbered from the start v     *
+*    of a pseudo-diameter, always taking next the queued node of         *
+*    highest priority: the farthest from the end u, and the one that     *
+*    adds the fewest nodes to the wavefront. Nodes are queued once a     *
+*    neighbor is, and numbering a node raises the priority of the        *
+*    nodes it takes off the wavefront. The permutation is not reversed   *
+**************************************************************************
+*/
+
+RCMStatus sloan(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation)
+{
+	//! A node of a valid matrix has fewer than n neighbors, which
+	//! is all the room the buffers of the workspace have for them
+	int max_degree = max_degree_of(degrees, n);
+	if (max_degree >= n && n > 0)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	Workspace *W = C->workspace;
+	Diameter D;
+	init_diameter(&D, W, n, max_degree);
+	int *status = workspaceAlloc(W, n);						 // Status of every node
+	int *more = workspaceAlloc(W, max_degree + 1);			 // Neighbors of a neighbor
+	Heap H = {0, workspaceAlloc(W, n), workspaceAlloc(W, n), // Queued nodes
+			  workspaceAlloc(W, n)};
+	StartSelector S; // Nodes in increasing order of degree
+	initStartSelector(&S, degrees, n, workspaceAlloc(W, n), workspaceAlloc(W, n + 1));
+
+	for (int i = 0; i < n; i++)
+	{
+		status[i] = INACTIVE;
+		H.position[i] = -1;
+	}
+
+	int count = 0;
+	while (count < n)
+	{
+		//! Start from the unnumbered node of minimum degree, or
+		//! rather from a pseudo-diameter of its component
+		STATS_START(start);
+		int root = nextStartNode(&S, status);
+		if (degrees[root] == 0)
+		{
+			STATS_STOP(start, RCM_PHASE_START);
+			permutation[count++] = root;
+			status[root] = POSTACTIVE;
+			continue;
+		}
+		pseudo_diameter(A, n, degrees, gather, root, &D);
+		STATS_STOP(start, RCM_PHASE_START);
+
+		for (int i = 0; i < D.num_nodes; i++)
+		{
+			int node = D.nodes[i];
+			H.priority[node] = SLOAN_DISTANCE_WEIGHT * D.level_u[node] - SLOAN_DEGREE_WEIGHT * (degrees[node] + 1);
+		}
+
+		status[D.v] = PREACTIVE;
+		heap_push(&H, D.v);
+
+		while (H.size > 0)
+		{
+			int node = heap_pop(&H);
+
+			STATS_START(gather_time);
+			int num_of_neigh = gather(A, n, degrees, node, D.neighbors);
+			STATS_STOP(gather_time, RCM_PHASE_GATHER);
+
+			//! A preactive node takes all its neighbors to the wavefront
+			if (status[node] == PREACTIVE)
+				for (int i = 0; i < num_of_neigh; i++)
+					if (status[D.neighbors[i]] != POSTACTIVE)
+						raise_priority(&H, status, D.neighbors[i]);
+
+			permutation[count++] = node;
+			status[node] = POSTACTIVE;
+
+			//! Its preactive neighbors become active, taking
+			//! their own neighbors to the wavefront in turn
+			for (int i = 0; i < num_of_neigh; i++)
+			{
+				int neighbor = D.neighbors[i];
+				if (status[neighbor] != PREACTIVE)
+					continue;
+
+				status[neighbor] = ACTIVE;
+				raise_priority(&H, status, neighbor);
+
+				STATS_START(gather_time);
+				int num_of_more = gather(A, n, degrees, neighbor, more);
+				STATS_STOP(gather_time, RCM_PHASE_GATHER);
+
+				for (int j = 0; j < num_of_more; j++)
+					if (status[more[j]] != POSTACTIVE)
+						raise_priority(&H, status, more[j]);
+			}
+		}
+	}
+
+	return RCM_OK;
+}
+
+/*
+**************************************************************************
+*    Gibbs-Poole-Stockmeyer. The level structures rooted at both ends    *
+*    of a pseudo-diameter of every component are combined into one as    *
+*    narrow as possible: nodes at the same level from both ends stay     *
+*    there, and each connected part of the rest, largest first, takes    *
+*    the levels from whichever end keeps the widest level narrower.      *
+*    The structure is then numbered a level at a time as Cuthill-McKee   *
+*    would, from the end of smaller degree, and the permutation is       *
+*    reversed                                                            *
+**************************************************************************
+*/
+
+RCMStatus gibbs_poole_stockmeyer(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation)
+{
+	//! A node of a valid matrix has fewer than n neighbors, which
+	//! is all the room the buffers of the workspace have for them
+	int max_degree = max_degree_of(degrees, n);
+	if (max_degree >= n && n > 0)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	Workspace *W = C->workspace;
+	Diameter D;
+	init_diameter(&D, W, n, max_degree);
+	int *numbered = workspaceAlloc(W, n); // Shows if the node is already numbered (0 or 1)
+	Levels L;
+	L.level = workspaceAlloc(W, n);
+	L.members = workspaceAlloc(W, n);
+	L.starts = workspaceAlloc(W, n + 1);
+	L.parts = workspaceAlloc(W, n);
+	L.keys = workspaceAlloc(W, n);
+	L.widths = workspaceAlloc(W, n + 1);
+	L.high = workspaceAlloc(W, n + 1);
+	L.low = workspaceAlloc(W, n + 1);
+	StartSelector S; // Nodes in increasing order of degree
+	initStartSelector(&S, degrees, n, workspaceAlloc(W, n), workspaceAlloc(W, n + 1));
+
+	for (int i = 0; i < n; i++)
+		numbered[i] = 0;
+
+	int count = 0;
+	while (count < n)
+	{
+		//! Start from the unnumbered node of minimum degree, or
+		//! rather from a pseudo-diameter of its component
+		STATS_START(start);
+		int root = nextStartNode(&S, numbered);
+		if (degrees[root] == 0)
+		{
+			STATS_STOP(start, RCM_PHASE_START);
+			permutation[count++] = root;
+			numbered[root] = 1;
+			continue;
+		}
+		pseudo_diameter(A, n, degrees, gather, root, &D);
+		root = combine_levels(A, n, degrees, gather, &D, &L);
+		STATS_STOP(start, RCM_PHASE_START);
+
+		count = number_levels(A, n, degrees, gather, &D, &L, root, numbered, permutation, count);
+	}
+
+	//! Reverse the permutation, as RCM does
+	reverse_array(permutation, n);
+
+	return RCM_OK;
+}
+
+static int max_degree_of(int *degrees, int n)
+{
+	int max_degree = 0;
+	for (int i = 0; i < n; i++)
+		if (degrees[i] > max_degree)
+			max_degree = degrees[i];
+
+	return max_degree;
+}
+
+static void init_diameter(Diameter *D, Workspace *W, int n, int max_degree)
+{
+	D->level_v = workspaceAlloc(W, n);
+	D->level_u = workspaceAlloc(W, n);
+	D->nodes = workspaceAlloc(W, n);
+	D->candidates = workspaceAlloc(W, n);
+	D->neighbors = workspaceAlloc(W, max_degree + 1);
+	D->scratch = workspaceAlloc(W, n + 1);
+
+	for (int i = 0; i < n; i++)
+		D->level_v[i] = D->level_u[i] = -1;
+}
+
+/*
+**************************************************************************
+*    Pseudo-diameter of the component of root, as GPS find it. From      *
+*    the levels rooted at v (first root), those rooted at one node of    *
+*    every degree in the last level are built, in increasing order of    *
+*    degree. The first that is deeper takes the place of v, and the      *
+*    search starts over. Else the one with the narrowest levels is u.    *
+*    Only the nodes of the component are ever visited, so the levels     *
+*    of the other components are left alone                              *
+**************************************************************************
+*/
+
+static void pseudo_diameter(void *A, int n, int *degrees, gather_fn gather, int root, Diameter *D)
+{
+	int v = root;
+	int u = -1;
+	int depth = level_structure(A, n, degrees, gather, v, D->level_v, D->nodes, D->neighbors,
+								&D->num_nodes, &D->width_v);
+
+	while (u < 0)
+	{
+		//! The last level is at the end of nodes. Keep the first
+		//! node of every degree there, in increasing order of degree
+		int first = D->num_nodes;
+		while (first > 0 && D->level_v[D->nodes[first - 1]] == depth)
+			first--;
+
+		int num_candidates = D->num_nodes - first;
+		for (int i = 0; i < num_candidates; i++)
+			D->candidates[i] = D->nodes[first + i];
+		degreeSort(D->candidates, degrees, num_candidates, D->scratch);
+
+		int distinct = 0;
+		for (int i = 0; i < num_candidates; i++)
+			if (distinct == 0 || degrees[D->candidates[i]] != degrees[D->candidates[distinct - 1]])
+				D->candidates[distinct++] = D->candidates[i];
+
+		int deeper = -1;
+		int narrowest = INT_MAX;
+		for (int i = 0; i < distinct && deeper < 0; i++)
+		{
+			int num_nodes;
+			int width;
+			int candidate_depth = level_structure(A, n, degrees, gather, D->candidates[i], D->level_u,
+												  D->nodes, D->neighbors, &num_nodes, &width);
+			clear_levels(D->level_u, D->nodes, num_nodes);
+
+			if (candidate_depth > depth)
+				deeper = D->candidates[i];
+			else if (width < narrowest)
+			{
+				u = D->candidates[i];
+				narrowest = width;
+			}
+		}
+
+		if (deeper >= 0)
+		{
+			clear_levels(D->level_v, D->nodes, D->num_nodes);
+			v = deeper;
+			u = -1;
+			depth = level_structure(A, n, degrees, gather, v, D->level_v, D->nodes, D->neighbors,
+									&D->num_nodes, &D->width_v);
+		}
+	}
+
+	//! Both ends are as far as v is from any node, so the levels
+	//! rooted at u are just as deep
+	D->v = v;
+	D->u = u;
+	D->depth = depth;
+	level_structure(A, n, degrees, gather, u, D->level_u, D->nodes, D->neighbors, &D->num_nodes, &D->width_u);
+}
+
+/*
+***********************************************************************
+*    Breadth-first search from root, storing the level of every       *
+*    node reached to level and the nodes themselves, level by level,  *
+*    to nodes. Returns the index of the last level, along with the    *
+*    number of nodes and of the nodes of the widest level             *
+***********************************************************************
+*/
+
+static int level_structure(void *A, int n, int *degrees, gather_fn gather, int root,
+						   int *level, int *nodes, int *neighbors, int *num_nodes, int *width)
+{
+	int head = 0;
+	int tail = 0;
+
+	nodes[tail++] = root;
+	level[root] = 0;
+
+	while (head < tail)
+	{
+		int node = nodes[head++];
+		int count = gather(A, n, degrees, node, neighbors);
+
+		for (int i = 0; i < count; i++)
+			if (level[neighbors[i]] < 0)
+			{
+				level[neighbors[i]] = level[node] + 1;
+				nodes[tail++] = neighbors[i];
+			}
+	}
+
+	//! Levels are contiguous in nodes, so the widest is the longest run
+	*width = 0;
+	for (int i = 0, run = 0; i < tail; i++)
+	{
+		run = (i > 0 && level[nodes[i]] == level[nodes[i - 1]]) ? run + 1 : 1;
+		if (run > *width)
+			*width = run;
+	}
+	*num_nodes = tail;
+
+	return level[nodes[tail - 1]];
+}
+
+static void clear_levels(int *level, int *nodes, int num_nodes)
+{
+	for (int i = 0; i < num_nodes; i++)
+		level[nodes[i]] = -1;
+}
+
+/*
+*************************************************************************
+*    Binary max-heap of the queued nodes of Sloan's algorithm, which    *
+*    keeps the position of every node in it, so that raising its        *
+*    priority costs O(log n). Ties go to the node of smaller index      *
+*************************************************************************
+*/
+
+//! Raise the priority of a node not numbered yet,
+//! and queue it if it was inactive
+static void raise_priority(Heap *H, int *status, int node)
+{
+	H->priority[node] += SLOAN_DEGREE_WEIGHT;
+
+	if (status[node] == INACTIVE)
+	{
+		status[node] = PREACTIVE;
+		heap_push(H, node);
+	}
+	else if (H->position[node] >= 0)
+		sift_up(H, H->position[node]);
+}
+
+static void heap_push(Heap *H, int node)
+{
+	H->nodes[H->size] = node;
+	sift_up(H, H->size++);
+}
+
+static int heap_pop(Heap *H)
+{
+	int top = H->nodes[0];
+	H->position[top] = -1;
+
+	if (--H->size > 0)
+	{
+		H->nodes[0] = H->nodes[H->size];
+		sift_down(H, 0);
+	}
+
+	return top;
+}
+
+static void sift_up(Heap *H, int i)
+{
+	int node = H->nodes[i];
+
+	while (i > 0 && heap_before(H, node, H->nodes[(i - 1) / 2]))
+	{
+		H->nodes[i] = H->nodes[(i - 1) / 2];
+		H->position[H->nodes[i]] = i;
+		i = (i - 1) / 2;
+	}
+
+	H->nodes[i] = node;
+	H->position[node] = i;
+}
+
+static void sift_down(Heap *H, int i)
+{
+	int node = H->nodes[i];
+
+	while (2 * i + 1 < H->size)
+	{
+		int child = 2 * i + 1;
+		if (child + 1 < H->size && heap_before(H, H->nodes[child + 1], H->nodes[child]))
+			child++;
+		if (!heap_before(H, H->nodes[child], node))
+			break;
+
+		H->nodes[i] = H->nodes[child];
+		H->position[H->nodes[i]] = i;
+		i = child;
+	}
+
+	H->nodes[i] = node;
+	H->position[node] = i;
+}
+
+static int heap_before(Heap *H, int a, int b)
+{
+	return H->priority[a] > H->priority[b] || (H->priority[a] == H->priority[b] && a < b);
+}
+
+/*
+**************************************************************************
+*    Combine the levels rooted at both ends of the pseudo-diameter       *
+*    into L->level. Nodes at the same level from both ends (counting     *
+*    the levels rooted at u backwards) are placed first. The rest        *
+*    splits into connected parts, which are placed in decreasing         *
+*    order of size, every one with the levels rooted at v or at u,       *
+*    whichever gives its widest level fewer nodes (or, for a tie,        *
+*    whichever structure is narrower). Returns the end to number from:   *
+*    the one of smaller degree, whose level is made 0                    *
+**************************************************************************
+*/
+
+static int combine_levels(void *A, int n, int *degrees, gather_fn gather, Diameter *D, Levels *L)
+{
+	int depth = D->depth;
+	for (int l = 0; l <= depth; l++)
+		L->widths[l] = L->high[l] = L->low[l] = 0;
+
+	for (int i = 0; i < D->num_nodes; i++)
+	{
+		int node = D->nodes[i];
+		if (D->level_v[node] == depth - D->level_u[node])
+			L->widths[L->level[node] = D->level_v[node]]++;
+		else
+			L->level[node] = -1;
+	}
+
+	//! Label the parts by breadth-first search over the nodes not
+	//! placed, marking them with -2 as they are reached
+	int num_parts = 0;
+	int size = 0;
+	for (int i = 0; i < D->num_nodes; i++)
+	{
+		if (L->level[D->nodes[i]] != -1)
+			continue;
+
+		L->starts[num_parts] = size;
+		L->members[size++] = D->nodes[i];
+		L->level[D->nodes[i]] = -2;
+
+		for (int head = L->starts[num_parts]; head < size; head++)
+		{
+			int count = gather(A, n, degrees, L->members[head], D->neighbors);
+
+			for (int k = 0; k < count; k++)
+				if (L->level[D->neighbors[k]] == -1)
+				{
+					L->level[D->neighbors[k]] = -2;
+					L->members[size++] = D->neighbors[k];
+				}
+		}
+
+		L->keys[num_parts] = n - (size - L->starts[num_parts]);
+		L->parts[num_parts] = num_parts;
+		num_parts++;
+	}
+	L->starts[num_parts] = size;
+	degreeSort(L->parts, L->keys, num_parts, D->scratch);
+
+	for (int p = 0; p < num_parts; p++)
+	{
+		int *members = L->members + L->starts[L->parts[p]];
+		int num_members = L->starts[L->parts[p] + 1] - L->starts[L->parts[p]];
+
+		for (int i = 0; i < num_members; i++)
+		{
+			L->high[D->level_v[members[i]]]++;
+			L->low[depth - D->level_u[members[i]]]++;
+		}
+
+		//! The widest level each choice would give, among the
+		//! levels the part adds nodes to
+		int max_high = 0;
+		int max_low = 0;
+		for (int i = 0; i < num_members; i++)
+		{
+			int high = D->level_v[members[i]];
+			int low = depth - D->level_u[members[i]];
+
+			if (L->widths[high] + L->high[high] > max_high)
+				max_high = L->widths[high] + L->high[high];
+			if (L->widths[low] + L->low[low] > max_low)
+				max_low = L->widths[low] + L->low[low];
+		}
+
+		for (int i = 0; i < num_members; i++)
+			L->high[D->level_v[members[i]]] = L->low[depth - D->level_u[members[i]]] = 0;
+
+		int from_v = max_high < max_low || (max_high == max_low && D->width_v <= D->width_u);
+		for (int i = 0; i < num_members; i++)
+		{
+			int node = members[i];
+			L->level[node] = from_v ? D->level_v[node] : depth - D->level_u[node];
+			L->widths[L->level[node]]++;
+		}
+	}
+
+	if (degrees[D->u] >= degrees[D->v])
+		return D->v;
+
+	for (int i = 0; i < D->num_nodes; i++)
+		L->level[D->nodes[i]] = depth - L->level[D->nodes[i]];
+
+	return D->u;
+}
+
+/*
+**************************************************************************
+*    Number the component a level at a time from root, after the         *
+*    count nodes numbered before. Every level takes first the            *
+*    neighbors of the previous level, node by node in the order it       *
+*    was numbered, then the neighbors within the level of its own        *
+*    numbered nodes in turn, and, whenever those run out, its node of    *
+*    minimum degree still unnumbered. Neighbors are taken in             *
+*    increasing order of degree. Returns the nodes numbered so far       *
+**************************************************************************
+*/
+
+static int number_levels(void *A, int n, int *degrees, gather_fn gather, Diameter *D, Levels *L,
+						 int root, int *numbered, int *permutation, int count)
+{
+	int depth = D->depth;
+
+	//! The nodes of every level in increasing order of degree,
+	//! sorted by degree first and then stably by level
+	for (int i = 0; i < D->num_nodes; i++)
+		L->parts[i] = D->nodes[i];
+	degreeSort(L->parts, degrees, D->num_nodes, D->scratch);
+
+	for (int l = 0; l <= depth + 1; l++)
+		L->starts[l] = 0;
+	for (int i = 0; i < D->num_nodes; i++)
+		L->starts[L->level[L->parts[i]] + 1]++;
+	for (int l = 0; l <= depth; l++)
+		L->starts[l + 1] += L->starts[l];
+
+	//! The widths are free by now, and keep where every level is filled
+	for (int l = 0; l <= depth; l++)
+		L->widths[l] = L->starts[l];
+	for (int i = 0; i < D->num_nodes; i++)
+		L->members[L->widths[L->level[L->parts[i]]]++] = L->parts[i];
+
+	int first = count;
+	permutation[count++] = root;
+	numbered[root] = 1;
+
+	int previous_begin = first;
+	int previous_end = first;
+	for (int l = 0; l <= depth; l++)
+	{
+		int begin = (l == 0) ? first : count;
+
+		for (int p = previous_begin; p < previous_end; p++)
+			count = number_neighbors(A, n, degrees, gather, D, L->level, permutation[p], l,
+									 numbered, permutation, count);
+
+		int cursor = L->starts[l];
+		for (int p = begin;; p++)
+		{
+			if (p == count)
+			{
+				while (cursor < L->starts[l + 1] && numbered[L->members[cursor]])
+					cursor++;
+				if (cursor == L->starts[l + 1])
+					break;
+
+				permutation[count++] = L->members[cursor];
+				numbered[L->members[cursor]] = 1;
+			}
+
+			count = number_neighbors(A, n, degrees, gather, D, L->level, permutation[p], l,
+									 numbered, permutation, count);
+		}
+
+		previous_begin = begin;
+		previous_end = count;
+	}
+
+	return count;
+}
+
+//! Number the unnumbered neighbors of node in level l,
+//! in increasing order of degree
+static int number_neighbors(void *A, int n, int *degrees, gather_fn gather, Diameter *D, int *level,
+							int node, int l, int *numbered, int *permutation, int count)
+{
+	int num_of_neigh = gather(A, n, degrees, node, D->neighbors);
+
+	int kept = 0;
+	for (int i = 0; i < num_of_neigh; i++)
+		if (level[D->neighbors[i]] == l && !numbered[D->neighbors[i]])
+			D->neighbors[kept++] = D->neighbors[i];
+
+	degreeSort(D->neighbors, degrees, kept, D->scratch);
+
+	for (int i = 0; i < kept; i++)
+	{
+		permutation[count++] = D->neighbors[i];
+		numbered[D->neighbors[i]] = 1;
+	}
+
+	return count;
+}
@@ -0,0 +1,47 @@
+/*
+*******************************************************
+*    Orderings shared by both implementations (see    *
+*    RCMOrdering). Private to the library, not        *
+*    installed                                        *
+*******************************************************
+*/
+
+#ifndef RCM_ORDER_H
+#define RCM_ORDER_H
+
+#include "../inc/rcm.h"
+
+/*
+*******************************************************************
+*    Signature of the functions that store the neighbors of an    *
+*    element to an array and return how many they are, one for    *
+*    each supported matrix format                                 *
+*******************************************************************
+*/
+
+typedef int (*gather_fn)(void *A, int n, int *degrees, int element_idx, int *neighbors);
+
+//! Formats of the matrix given to reorder()
+typedef enum Format
+{
+	FORMAT_DENSE,
+	FORMAT_CSR,
+	FORMAT_BITSET
+} Format;
+
+//! Ints Sloan and GPS take from the workspace, besides the degrees
+#define ORDER_WORKSPACE(n) (18 * (size_t)(n) + 8)
+
+//! Orderings computed by order.c from a pseudo-diameter, instead of by the engine
+#define FROM_PSEUDO_DIAMETER(ordering) ((ordering) == RCM_ORDERING_SLOAN || (ordering) == RCM_ORDERING_GPS)
+
+//! The sequential implementation, built into the OpenMP library
+//! as its sequential backend
+RCMStatus reorder_sequential(RCMContext *C, void *A, int n, Format format, int *permutation);
+
+//! Sloan's and Gibbs-Poole-Stockmeyer's orderings, given the
+//! degrees of all nodes and the gather() of the matrix format
+RCMStatus sloan(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation);
+RCMStatus gibbs_poole_stockmeyer(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation);
+
+#endif
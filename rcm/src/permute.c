@@ -0,0 +1,140 @@
+/*
+******************************************************
+*    Applying a permutation to matrices and vectors    *
+******************************************************
+*/
+
+#include "../inc/rcm.h"
+
+//! Rows up to that length are sorted by insertion, longer ones by qsort()
+#define INSERTION_SORT_MAX 16
+
+static void sort_row(int *row, int length);
+static int compare_int(const void *a, const void *b);
+
+int *inverse_permutation(const int *permutation, int n)
+{
+	int *inverse = malloc((n > 0 ? n : 1) * sizeof(int));
+	if (inverse == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for 'inverse' failed\n\n");
+		return NULL;
+	}
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		inverse[permutation[i]] = i;
+
+	return inverse;
+}
+
+/*
+*************************************************************************
+*    Symmetric permutation of a sparsity pattern: row i of the result   *
+*    is row permutation[i] of the given one, with every column j        *
+*    renumbered to the position of j in the permutation. The lengths    *
+*    of the rows are counted, prefix-summed to new_row_ptr, and then    *
+*    every row is scattered to its own part of new_col_idx, all rows    *
+*    in parallel                                                        *
+*************************************************************************
+*/
+
+int permute_pattern(int n, const RCMOffset *row_ptr, const int *col_idx, const int *permutation,
+					RCMOffset *new_row_ptr, int *new_col_idx, int sort_rows)
+{
+	int *inverse = inverse_permutation(permutation, n);
+	if (inverse == NULL)
+		return -1;
+
+	new_row_ptr[0] = 0;
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		new_row_ptr[i + 1] = row_ptr[permutation[i] + 1] - row_ptr[permutation[i]];
+
+	for (int i = 0; i < n; i++)
+		new_row_ptr[i + 1] += new_row_ptr[i];
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < n; i++)
+	{
+		const int *from = col_idx + row_ptr[permutation[i]];
+		int *to = new_col_idx + new_row_ptr[i];
+		int length = new_row_ptr[i + 1] - new_row_ptr[i];
+
+		for (int k = 0; k < length; k++)
+			to[k] = inverse[from[k]];
+
+		if (sort_rows)
+			sort_row(to, length);
+	}
+
+	free(inverse);
+
+	return 0;
+}
+
+CSR *permute_csr(CSR *A, const int *permutation, int sort_rows)
+{
+	CSR *B = createCSR(A->n, A->nnz);
+	if (B == NULL)
+		return NULL;
+
+	if (permute_pattern(A->n, A->row_ptr, A->col_idx, permutation, B->row_ptr, B->col_idx, sort_rows) != 0)
+	{
+		freeCSR(B);
+		return NULL;
+	}
+
+	return B;
+}
+
+/*
+*****************************************************************
+*    Vectors: permute_vector() gives y = P x, the right-hand    *
+*    side of the permuted system, and unpermute_vector() the    *
+*    opposite, taking its solution back to the original order   *
+*****************************************************************
+*/
+
+void permute_vector(const double *x, const int *permutation, int n, double *y)
+{
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		y[i] = x[permutation[i]];
+}
+
+void unpermute_vector(const double *y, const int *permutation, int n, double *x)
+{
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+		x[permutation[i]] = y[i];
+}
+
+static void sort_row(int *row, int length)
+{
+	if (length > INSERTION_SORT_MAX)
+	{
+		qsort(row, length, sizeof(int), compare_int);
+		return;
+	}
+
+	for (int i = 1; i < length; i++)
+	{
+		int key = row[i];
+		int j = i - 1;
+		while (j >= 0 && row[j] > key)
+		{
+			row[j + 1] = row[j];
+			j--;
+		}
+		row[j + 1] = key;
+	}
+}
+
+static int compare_int(const void *a, const void *b)
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
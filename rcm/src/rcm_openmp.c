@@ -7,150 +7,1184 @@
 */
 
 #include <omp.h>
+#include <limits.h>
 #include "../inc/rcm.h"
+#include "order.h"
+#include "stats.h"
+#include "tuning.h"
 
-//! Define number of threads
-#define NUM_THREADS omp_get_max_threads() // Set threads as the number of cores (4 in my case)
+//! Define number of threads. Called from inside a parallel region (e.g. by
+//! rcm_csr_batch(), one matrix per thread), a reordering runs on its thread alone
+#define NUM_THREADS (omp_in_parallel() ? 1 : omp_get_max_threads()) // Set threads as the number of cores (4 in my case)
 
-//! Define thresholds for parallelism
-#define THRES_1 2000 // Threshold for parallelization of degrees array creation
-#define THRES_2 1000 // Threshold for parallelization of neighbors' searching
-#define THRES_3 100	 // Threshold for parallelization of neighbors' sorting
+//! Thresholds for parallelism and threads of each parallel phase. They
+//! start at the values tuned on a 4-core laptop, and can be calibrated
+//! for the host or loaded from a file (see RCMTuning)
+#define THRES_1 active->loop_threshold		// Threshold for parallelization of degrees array creation
+#define THRES_2 active->gather_threshold	// Threshold for parallelization of neighbors' searching
+#define THRES_3 active->sort_threshold		// Threshold for parallelization of neighbors' sorting
+#define THRES_4 active->level_threshold		// Threshold for parallelization of a BFS level
+#define THRES_5 active->component_threshold // Threshold for traversing a component alone instead of as a task
+
+#define THREADS(count) ((count) > 0 && !omp_in_parallel() ? (count) : NUM_THREADS)
+#define LOOP_THREADS THREADS(active->loop_threads)
+#define GATHER_THREADS THREADS(active->gather_threads)
+#define SORT_THREADS THREADS(active->sort_threads)
+#define LEVEL_THREADS THREADS(active->level_threads)
+
+//! The tuning the phases read. It is the one in use on every thread but
+//! one that is calibrating, which points it at a copy of its own, so
+//! reorderings running meanwhile never see the thresholds it forces
+static RCMTuning *active = &tuning;
+#pragma omp threadprivate(active)
+
+//! Dense input along with the index of the last neighbor of every row
+typedef struct Dense
+{
+	int *X;
+	int *last_neighbors;
+} Dense;
+
+static int *reorder_new(void *A, int n, Format format, Workspace *W);
+static RCMStatus reorder(RCMContext *C, void *A, int n, Format format, int *permutation);
+static int csr_degrees(RCMOffset *row_ptr, int *col_idx, int n, int *degrees);
+static RCMStatus cuthill_mckee(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation);
+static RCMStatus cuthill_mckee_queue(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation);
+static RCMStatus traverse_component(void *A, int n, int *degrees, gather_fn gather, int root,
+									int *inserted, Queue *R, Queue *Q, Workspace *W,
+									int *level, int *nodes, int *neighbors);
+static RCMStatus cuthill_mckee_components(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation);
+static RCMStatus traverse_slice(void *A, int n, int *degrees, gather_fn gather, int start, int offset, int size,
+								int *inserted, int *result, int *queue, int *space,
+								int *level, int *nodes, int *neighbors);
+static int label_components(void *A, int n, int *degrees, gather_fn gather, int *component);
+static int find_root(int *component, int x);
+static void unite(int *component, int a, int b);
+static RCMStatus cuthill_mckee_levels(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *R);
+static int expand_rcm_level(void *A, int n, int *degrees, gather_fn gather,
+							int *R, int *parent, int begin, int end);
+static void sort_level(int *nodes, int num_nodes, int *degrees, int *parent, int *index, int *scratch);
+static int pseudo_peripheral_node(void *A, int n, int *degrees, gather_fn gather,
+								  int root, int *level, int *nodes, int *neighbors);
+static int level_structure(void *A, int n, int *degrees, gather_fn gather, int root,
+						   int *level, int *nodes, int *neighbors, int *num_nodes);
+static int expand_level_serial(void *A, int n, int *degrees, gather_fn gather,
+							   int *level, int *nodes, int *neighbors, int begin, int end, int depth);
+static int expand_level(void *A, int n, int *degrees, gather_fn gather,
+						int *level, int *nodes, int begin, int end, int depth);
+static RCMStatus add_neighbors(void *A, int n, int *degrees, gather_fn gather,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W);
+static int add_neighbors_ws(void *A, int n, int *degrees, gather_fn gather,
+							int *inserted, Queue *Q, int element_idx, Workspace *W);
+static int gather_dense(void *A, int n, int *degrees, int element_idx, int *neighbors);
+static int gather_dense_row(int *X, int n, int element_idx, int last_neighbor_idx, int *neighbors);
+static int gather_csr(void *A, int n, int *degrees, int element_idx, int *neighbors);
+static int gather_bitset(void *A, int n, int *degrees, int element_idx, int *neighbors);
+static int extract_bits(uint64_t *row, int from, int to, int skip, int *neighbors);
+static int sort_and_enqueue(int *neighbors, int num_of_neigh, int *degrees,
+							int *inserted, Queue *Q, int *scratch);
+static void parallel_radix_sort(int *arr1, int *arr2, int n, int *scratch);
+static double calibrate_phase(int phase, int size, int threads, RCMOffset *row_ptr, int *col_idx,
+							  int *keys, int *nodes, int *level, int *buffer);
 
 int *rcm(int *X, int n)
 {
-	Queue *Q = createQueue(n); // Queue array
-	Queue *R = createQueue(n); // Result array
+	return rcm_ws(X, n, NULL);
+}
+
+int *rcm_csr(RCMOffset *row_ptr, int *col_idx, int n)
+{
+	return rcm_csr_ws(row_ptr, col_idx, n, NULL);
+}
+
+int *rcm_bitset(BitMatrix *B)
+{
+	return rcm_bitset_ws(B, NULL);
+}
 
-	int *degrees = malloc(n * sizeof(int));		   // Array containing degree of all nodes
-	int *last_neighbors = malloc(n * sizeof(int)); // Array containining the index of the last neighbors
-	int *inserted = malloc(n * sizeof(int));	   // Shows if the node is already inserted to R or Q (0 or 1)
+int *rcm_ws(int *X, int n, Workspace *W)
+{
+	return reorder_new(X, n, FORMAT_DENSE, W);
+}
 
-	//! Check for malloc failures
-	if (degrees == NULL)
+int *rcm_csr_ws(RCMOffset *row_ptr, int *col_idx, int n, Workspace *W)
+{
+	CSR A = {n, row_ptr[n], row_ptr, col_idx};
+	return reorder_new(&A, n, FORMAT_CSR, W);
+}
+
+int *rcm_bitset_ws(BitMatrix *B, Workspace *W)
+{
+	return reorder_new(B, B->n, FORMAT_BITSET, W);
+}
+
+RCMStatus rcm_ctx(RCMContext *C, int *X, int n, int *permutation)
+{
+	if (C == NULL || X == NULL || n < 0 || permutation == NULL)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	return reorder(C, X, n, FORMAT_DENSE, permutation);
+}
+
+RCMStatus rcm_csr_ctx(RCMContext *C, RCMOffset *row_ptr, int *col_idx, int n, int *permutation)
+{
+	if (C == NULL || row_ptr == NULL || col_idx == NULL || n < 0 || permutation == NULL)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	CSR A = {n, row_ptr[n], row_ptr, col_idx};
+	return reorder(C, &A, n, FORMAT_CSR, permutation);
+}
+
+RCMStatus rcm_bitset_ctx(RCMContext *C, BitMatrix *B, int *permutation)
+{
+	if (C == NULL || B == NULL || permutation == NULL)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	return reorder(C, B, B->n, FORMAT_BITSET, permutation);
+}
+
+/*
+************************************************************************
+*    The functions without a context reorder on a temporary one,       *
+*    around the caller's workspace if there is one, into a new         *
+*    permutation. They return NULL on failure                          *
+************************************************************************
+*/
+
+static int *reorder_new(void *A, int n, Format format, Workspace *W)
+{
+	RCMContext C = {W, rcm_get_start_mode(), rcm_get_engine(), rcm_get_ordering(), rcm_get_backend()};
+	if (W == NULL)
+		C.workspace = createWorkspace(0);
+	int *permutation = malloc((n > 0 ? n : 1) * sizeof(int));
+
+	RCMStatus status = RCM_ERROR_OUT_OF_MEMORY;
+	if (C.workspace != NULL && permutation != NULL)
+		status = reorder(&C, A, n, format, permutation);
+
+	if (W == NULL)
+		freeWorkspace(C.workspace);
+
+	if (status != RCM_OK)
+	{
+		printf(RED "Error:" RESET_COLOR " Reordering failed: %s\n\n", rcm_status_string(status));
+		free(permutation);
+		return NULL;
+	}
+
+	return permutation;
+}
+
+/*
+************************************************************************
+*    Everything a reordering needs of size n is taken from the         *
+*    workspace of the context, and given back at the end. It makes     *
+*    room for all of it at once, before taking any, since taken        *
+*    pointers are invalid once it grows: the degrees (and the last     *
+*    neighbors of dense rows) and the arrays of the engine, counting   *
+*    every neighbor buffer as n ints, the most a node can have. Only   *
+*    the lists of the threads of a parallel phase are allocated        *
+************************************************************************
+*/
+
+static RCMStatus reorder(RCMContext *C, void *A, int n, Format format, int *permutation)
+{
+	//! The sequential backend reorders on the calling thread alone
+	if (C->backend == RCM_BACKEND_SEQUENTIAL)
+		return reorder_sequential(C, A, n, format, permutation);
+
+	//! The queue takes the queue, the inserted flags, the start selector
+	//! and its counters, the level structure of the pseudo-peripheral
+	//! search and three neighbor buffers. The levels take their sort
+	//! keys and space instead of the queue, and the components take
+	//! their labels, numbers and slices besides. Sloan and GPS take
+	//! their own arrays instead of any of those
+	size_t need = (format == FORMAT_DENSE) ? 2 * (size_t)n : n;
+	if (FROM_PSEUDO_DIAMETER(C->ordering))
+		need += ORDER_WORKSPACE(n);
+	else
+		need += ((C->engine == RCM_ENGINE_COMPONENTS) ? 14 * (size_t)n : 9 * (size_t)n) + 3;
+
+	Workspace *W = C->workspace;
+	size_t mark = workspaceMark(W);
+	if (reserveWorkspace(W, mark + need) != 0)
+		return RCM_ERROR_OUT_OF_MEMORY;
+
+	int *degrees = workspaceAlloc(W, n); // Array containing degree of all nodes
+	Dense dense = {(int *)A, NULL};
+	void *matrix = A;
+	gather_fn gather;
+	int invalid = 0; // entries out of range
+
+	STATS_START(start);
+	if (format == FORMAT_DENSE)
+	{
+		//! Find degree of each node (sum of non-diagonial elements
+		//! of each corresponding row). For each element, also
+		//! store the index of its last neighbor for later
+		//! Do it parallel only if n > THRES_1
+		int *X = dense.X;
+		int *last_neighbors = dense.last_neighbors = workspaceAlloc(W, n);
+		int i_;
+		if (n > THRES_1)
+		{
+			STATS_START(region);
+#pragma omp parallel private(i_) num_threads(LOOP_THREADS)
+			{
+#pragma omp for schedule(dynamic)
+				for (i_ = 0; i_ < n; i_++)
+					degrees[i_] = row_count_nonzeros(X + (size_t)n * i_, n, i_, &last_neighbors[i_]);
+			}
+			STATS_REGION(region);
+		}
+		else
+			for (i_ = 0; i_ < n; i_++)
+				degrees[i_] = row_count_nonzeros(X + (size_t)n * i_, n, i_, &last_neighbors[i_]);
+
+		matrix = &dense;
+		gather = gather_dense;
+	}
+	else if (format == FORMAT_CSR)
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for degrees failed\n\n");
-		exit(1);
+		CSR *csr = (CSR *)A;
+		invalid = csr_degrees(csr->row_ptr, csr->col_idx, n, degrees);
+		STATS_REGION(start);
+		advise_mapped(csr->col_idx, RCM_ACCESS_RANDOM);
+		gather = gather_csr;
 	}
-	if (last_neighbors == NULL)
+	else
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for last_neighbors failed\n\n");
-		exit(1);
+		//! Find degree of each node (number of set bits of each
+		//! corresponding row, not counting the diagonal), and
+		//! whether any bit past column n - 1 is set
+		//! Do it parallel only if n > THRES_1
+		BitMatrix *B = (BitMatrix *)A;
+		uint64_t padding = (n % 64) ? ~0ULL << (n % 64) : 0;
+#pragma omp parallel for schedule(static) reduction(+ : invalid) num_threads(LOOP_THREADS) if (n > THRES_1)
+		for (int i = 0; i < n; i++)
+		{
+			uint64_t *row = B->bits + (size_t)i * B->words_per_row;
+			int degree = 0;
+
+			for (int w = 0; w < B->words_per_row; w++)
+				degree += __builtin_popcountll(row[w]);
+			if (row[B->words_per_row - 1] & padding)
+				invalid++;
+
+			degrees[i] = degree - bitmatrix_get(B, i, i);
+		}
+		STATS_REGION(start);
+		advise_mapped(B->bits, RCM_ACCESS_RANDOM);
+		gather = gather_bitset;
 	}
-	if (inserted == NULL)
+	STATS_STOP(start, RCM_PHASE_DEGREES);
+
+	RCMStatus status;
+	if (invalid)
+		status = RCM_ERROR_INVALID_ARGUMENT;
+	else if (C->ordering == RCM_ORDERING_SLOAN)
+		status = sloan(matrix, n, degrees, gather, C, permutation);
+	else if (C->ordering == RCM_ORDERING_GPS)
+		status = gibbs_poole_stockmeyer(matrix, n, degrees, gather, C, permutation);
+	else
+		status = cuthill_mckee(matrix, n, degrees, gather, C, permutation);
+
+	workspaceRelease(W, mark);
+
+	return status;
+}
+
+//! Find degree of each node (number of non-diagonial entries
+//! stored in each corresponding row), and return the number of
+//! columns out of range. Rows are short, so this is only worth
+//! doing in parallel for n > THRES_1
+static int csr_degrees(RCMOffset *row_ptr, int *col_idx, int n, int *degrees)
+{
+	int invalid = 0;
+#pragma omp parallel for schedule(static) reduction(+ : invalid) num_threads(LOOP_THREADS) if (n > THRES_1)
+	for (int i = 0; i < n; i++)
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for inserted failed\n\n");
-		exit(1);
+		int degree = 0;
+
+		for (RCMOffset k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+			if (col_idx[k] < 0 || col_idx[k] >= n)
+				invalid++;
+			else if (col_idx[k] != i)
+				degree++;
+
+		degrees[i] = degree;
 	}
 
+	return invalid;
+}
+
+/*
+********************************************************************
+*    Traversal shared by all matrix formats. The degrees of all    *
+*    nodes must already be computed, and gather() knows how to     *
+*    find the neighbors of a node in the given matrix A            *
+********************************************************************
+*/
+
+static RCMStatus cuthill_mckee(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation)
+{
+	//! A node of a valid matrix has fewer than n neighbors, which
+	//! is all the room the buffers of the workspace have for them
+	int max_degree = 0;
+	STATS_START(region);
+#pragma omp parallel for schedule(static) reduction(max : max_degree) num_threads(LOOP_THREADS) if (n > THRES_1)
+	for (int i = 0; i < n; i++)
+		if (degrees[i] > max_degree)
+			max_degree = degrees[i];
+	STATS_REGION(region);
+	if (max_degree >= n && n > 0)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	RCMStatus status;
+	if (C->engine == RCM_ENGINE_LEVELS) // a whole level at a time
+		status = cuthill_mckee_levels(A, n, degrees, gather, C, permutation);
+	else if (C->engine == RCM_ENGINE_COMPONENTS) // the components concurrently
+		status = cuthill_mckee_components(A, n, degrees, gather, C, permutation);
+	else
+		status = cuthill_mckee_queue(A, n, degrees, gather, C, permutation);
+	if (status != RCM_OK)
+		return status;
+
+	//! Reverse R array, unless plain Cuthill-McKee was asked for
+	if (C->ordering != RCM_ORDERING_CM)
+		reverse_array(permutation, n);
+
+	return RCM_OK;
+}
+
+static RCMStatus cuthill_mckee_queue(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation)
+{
+	Workspace *W = C->workspace;
+	Queue Q = {n, 0, 0, -1, workspaceAlloc(W, n)}; // Queue array
+	Queue R = {n, 0, 0, -1, permutation};		   // Result array
+	int *inserted = workspaceAlloc(W, n);		   // Shows if the node is already inserted to R or Q (0 or 1)
+	StartSelector S;							   // Nodes in increasing order of degree
+	initStartSelector(&S, degrees, n, workspaceAlloc(W, n), workspaceAlloc(W, n + 1));
+
 	//! Initialize inserted array with zeros
 	for (int i = 0; i < n; i++)
 		inserted[i] = 0;
 
 	//! Initialize R array with -1
 	for (int i = 0; i < n; i++)
-		R->elements[i] = -1;
+		R.elements[i] = -1;
+
+	int max_degree = 0;
+	for (int i = 0; i < n; i++)
+		if (degrees[i] > max_degree)
+			max_degree = degrees[i];
 
-	//! Find degree of each node (sum of non-diagonial elements
-	//! of each corresponding row). For each element, also
-	//! store the index of its last neighbor for later
-	//! Do it parallel only if n > 2000
-	int i_;
-	if (n > THRES_1)
-#pragma omp parallel private(i_) num_threads(NUM_THREADS)
+	//! Working arrays of the search for pseudo-peripheral nodes
+	int *level = NULL;	   // Level of each node in the current level structure (-1 if none)
+	int *nodes = NULL;	   // Nodes of the current level structure, level by level
+	int *neighbors = NULL; // Neighbors of a single node
+	if (C->start_mode == RCM_START_PSEUDO_PERIPHERAL)
 	{
-#pragma omp for schedule(dynamic)
-		for (i_ = 0; i_ < n; i_++)
+		level = workspaceAlloc(W, n);
+		nodes = workspaceAlloc(W, n);
+		neighbors = workspaceAlloc(W, max_degree + 1);
+
+		for (int i = 0; i < n; i++)
+			level[i] = -1;
+	}
+
+	//! Do the algorithm until R is full, one component at a time
+	while (!isFull(&R))
+	{
+		//! Start from the object with minimum degree whose
+		//! index has not yet been inserted to R
+		STATS_START(start);
+		int min_degree_idx = nextStartNode(&S, inserted);
+		STATS_STOP(start, RCM_PHASE_START);
+
+		RCMStatus status = traverse_component(A, n, degrees, gather, min_degree_idx, inserted, &R, &Q, W,
+											  level, nodes, neighbors);
+		if (status != RCM_OK)
+			return status;
+	}
+
+	return RCM_OK;
+}
+
+/*
+****************************************************************
+*    Traverse the component of root (or of a pseudo-peripheral  *
+*    node of it, in that mode), appending its nodes to R.       *
+*    Fails if a buffer could not be allocated, or if a queue    *
+*    overflows, which only a matrix that is not valid can do    *
+****************************************************************
+*/
+
+static RCMStatus traverse_component(void *A, int n, int *degrees, gather_fn gather, int root,
+									int *inserted, Queue *R, Queue *Q, Workspace *W,
+									int *level, int *nodes, int *neighbors)
+{
+	//! In that mode, start from a pseudo-peripheral
+	//! node of the component instead
+	if (level != NULL && degrees[root])
+	{
+		STATS_START(start);
+		root = pseudo_peripheral_node(A, n, degrees, gather, root, level, nodes, neighbors);
+		STATS_STOP(start, RCM_PHASE_START);
+		if (root < 0)
+			return RCM_ERROR_OUT_OF_MEMORY;
+	}
+
+	//! Insert index of the start node to R
+	STATS_START(queue);
+	if (enqueue(R, root) != 0)
+		return RCM_ERROR_INVALID_ARGUMENT;
+	inserted[root] = 1;
+	STATS_STOP(queue, RCM_PHASE_QUEUE);
+	if (degrees[root])
+	{
+		//! Insert all of its neighbors (not already inserted to R)
+		//! to Q, sorted in increasing order of degree
+		RCMStatus status = add_neighbors(A, n, degrees, gather, inserted, Q, root, W);
+		if (status != RCM_OK)
+			return status;
+
+		//! While Q is not empty, extract its first node. If this
+		//! node has not been inserted in R, add it to R and add
+		//! its neighbors in increasing order of degree to Q
+		while (!isEmpty(Q))
 		{
-			int degree = 0;
-			int last_neighbor = 0;
+			//! Remove the first element of Q
+			STATS_START(queue);
+			int removed_item = peek(Q);
+			dequeue(Q);
 
-			for (int j = 0; j < n; j++)
-				if (X[n * i_ + j] && (j != i_))
-				{
-					last_neighbor = j;
-					degree++;
-				}
+			//! Insert index of this element to R
+			if (enqueue(R, removed_item) != 0)
+				return RCM_ERROR_INVALID_ARGUMENT;
+			STATS_STOP(queue, RCM_PHASE_QUEUE);
 
-			degrees[i_] = degree;
-			last_neighbors[i_] = last_neighbor;
+			//! If it has neighbors, add all of them (not already inserted
+			//! to R or Q) to Q, sorted in increasing order of degree
+			if (degrees[removed_item])
+			{
+				status = add_neighbors(A, n, degrees, gather, inserted, Q, removed_item, W);
+				if (status != RCM_OK)
+					return status;
+			}
 		}
 	}
-	else
-		for (i_ = 0; i_ < n; i_++)
+
+	return RCM_OK;
+}
+
+/*
+**************************************************************************
+*    Traversal of the connected components concurrently. Components     *
+*    are labeled first, and then ordered as the queue version reaches   *
+*    them: by their first node in increasing order of degree (and       *
+*    index). That fixes the slice of R each one fills, so they can be   *
+*    traversed independently, as tasks, and still give exactly the      *
+*    same permutation. Components larger than THRES_5 nodes are         *
+*    traversed one at a time instead, keeping the parallelism inside    *
+**************************************************************************
+*/
+
+static RCMStatus cuthill_mckee_components(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation)
+{
+	Workspace *W = C->workspace;
+	int *component = workspaceAlloc(W, n); // Smallest node of each node's component
+	StartSelector S;					   // Nodes in increasing order of degree
+	int *number = workspaceAlloc(W, n);	   // Number of the component of each smallest node
+	int *starts = workspaceAlloc(W, n);	   // First node of each component in the order of S
+	int *offsets = workspaceAlloc(W, n + 1); // Slice of R of each component
+
+	STATS_START(start);
+	if (label_components(A, n, degrees, gather, component) != 0)
+		return RCM_ERROR_OUT_OF_MEMORY;
+	initStartSelector(&S, degrees, n, workspaceAlloc(W, n), workspaceAlloc(W, n + 1));
+
+	for (int i = 0; i < n; i++)
+		number[i] = -1;
+	for (int i = 0; i <= n; i++)
+		offsets[i] = 0;
+
+	int num_components = 0;
+	for (int i = 0; i < n; i++)
+	{
+		int node = S.order[i];
+		if (number[component[node]] < 0)
 		{
-			int degree = 0;
-			int last_neighbor = 0;
+			number[component[node]] = num_components;
+			starts[num_components++] = node;
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+		offsets[number[component[i]] + 1]++;
+	for (int c = 0; c < num_components; c++)
+		offsets[c + 1] += offsets[c];
+	STATS_STOP(start, RCM_PHASE_START);
+
+	//! R, Q and all working space are cut in slices, one for each component,
+	//! since a component never needs more of them than its number of nodes
+	int *result = permutation;			  // Result array
+	int *queue = workspaceAlloc(W, n);	  // Space of the queue of each component
+	int *inserted = workspaceAlloc(W, n); // Shows if the node is already inserted to R or Q (0 or 1)
+
+	//! Space of the neighbors and their sorting, two ints for every node
+	int *space = workspaceAlloc(W, 2 * (size_t)n);
+
+	STATS_START(region);
+#pragma omp parallel for schedule(static) num_threads(LOOP_THREADS) if (n > THRES_1)
+	for (int i = 0; i < n; i++)
+		inserted[i] = 0;
+	STATS_REGION(region);
+
+	//! Working arrays of the search for pseudo-peripheral nodes
+	int *level = NULL;	   // Level of each node in the current level structure (-1 if none)
+	int *nodes = NULL;	   // Nodes of the current level structure, level by level
+	int *neighbors = NULL; // Neighbors of a single node
+	if (C->start_mode == RCM_START_PSEUDO_PERIPHERAL)
+	{
+		level = workspaceAlloc(W, n);
+		nodes = workspaceAlloc(W, n);
+		neighbors = workspaceAlloc(W, n);
+
+		STATS_START(levels);
+#pragma omp parallel for schedule(static) num_threads(LOOP_THREADS) if (n > THRES_1)
+		for (int i = 0; i < n; i++)
+			level[i] = -1;
+		STATS_REGION(levels);
+	}
+
+	//! Large components first, one at a time
+	for (int c = 0; c < num_components; c++)
+		if (offsets[c + 1] - offsets[c] > THRES_5)
+		{
+			RCMStatus status = traverse_slice(A, n, degrees, gather, starts[c], offsets[c], offsets[c + 1] - offsets[c],
+											  inserted, result, queue, space, level, nodes, neighbors);
+			if (status != RCM_OK)
+				return status;
+		}
 
-			for (int j = 0; j < n; j++)
-				if (X[n * i_ + j] && (j != i_))
+	//! Then all the rest, as tasks. A failed one fails them all
+	RCMStatus failed = RCM_OK;
+	STATS_START(tasks);
+#pragma omp parallel num_threads(NUM_THREADS) if (num_components > 1)
+#pragma omp single
+	for (int c = 0; c < num_components; c++)
+		if (offsets[c + 1] - offsets[c] <= THRES_5)
+		{
+#pragma omp task firstprivate(c) shared(failed) if (offsets[c + 1] - offsets[c] > 1)
+			{
+				RCMStatus status = traverse_slice(A, n, degrees, gather, starts[c], offsets[c], offsets[c + 1] - offsets[c],
+												  inserted, result, queue, space, level, nodes, neighbors);
+				if (status != RCM_OK)
 				{
-					last_neighbor = j;
-					degree++;
+#pragma omp atomic write
+					failed = status;
 				}
+			}
+		}
+	STATS_REGION(tasks);
+
+	return failed;
+}
+
+//! Traverse the component starting at start into its slice of R. Its
+//! workspace is its slice of space, which is always large enough
+static RCMStatus traverse_slice(void *A, int n, int *degrees, gather_fn gather, int start, int offset, int size,
+								int *inserted, int *result, int *queue, int *space,
+								int *level, int *nodes, int *neighbors)
+{
+	Queue R = {size, 0, 0, -1, result + offset};
+	Queue Q = {size, 0, 0, -1, queue + offset};
+	Workspace W = {2 * (size_t)size, 0, space + 2 * (size_t)offset};
+
+	if (level == NULL)
+		return traverse_component(A, n, degrees, gather, start, inserted, &R, &Q, &W,
+								  NULL, NULL, NULL);
+	else
+		return traverse_component(A, n, degrees, gather, start, inserted, &R, &Q, &W,
+								  level, nodes + offset, neighbors + offset);
+}
+
+/*
+***************************************************************************
+*    Label the connected components with a lock-free union-find. Every   *
+*    edge links the root of the larger index under the root of the       *
+*    smaller one with a compare-and-swap, so no cycle can ever form and  *
+*    each component ends up labeled by its smallest node. Returns 0, or  *
+*    -1 if the neighbor buffer of a thread could not be allocated        *
+***************************************************************************
+*/
+
+static int label_components(void *A, int n, int *degrees, gather_fn gather, int *component)
+{
+	int max_degree = 0;
+	STATS_START(region);
+#pragma omp parallel for schedule(static) reduction(max : max_degree) num_threads(LOOP_THREADS) if (n > THRES_1)
+	for (int i = 0; i < n; i++)
+	{
+		component[i] = i;
+		if (degrees[i] > max_degree)
+			max_degree = degrees[i];
+	}
+	STATS_REGION(region);
 
-			degrees[i_] = degree;
-			last_neighbors[i_] = last_neighbor;
+	int failed = 0;
+	STATS_START(link);
+#pragma omp parallel num_threads(LOOP_THREADS) if (n > THRES_1)
+	{
+		int *neighbors = malloc((max_degree + 1) * sizeof(int));
+		if (neighbors == NULL)
+		{
+			printf(RED "Error:" RESET_COLOR " Memory allocation for 'neighbors' failed\n\n");
+#pragma omp atomic write
+			failed = 1;
 		}
 
-	//! Do the algorithm until R is full
-	while (!isFull(R))
+#pragma omp for schedule(dynamic, 64)
+		for (int i = 0; i < n; i++)
+			if (degrees[i] && neighbors != NULL)
+			{
+				int num_of_neigh = gather(A, n, degrees, i, neighbors);
+				for (int k = 0; k < num_of_neigh; k++)
+					unite(component, i, neighbors[k]);
+			}
+
+		free(neighbors);
+	}
+	STATS_REGION(link);
+
+	if (failed)
+		return -1;
+
+	STATS_START(roots);
+#pragma omp parallel for schedule(static) num_threads(LOOP_THREADS) if (n > THRES_1)
+	for (int i = 0; i < n; i++)
+		component[i] = find_root(component, i);
+	STATS_REGION(roots);
+
+	return 0;
+}
+
+static int find_root(int *component, int x)
+{
+	int parent;
+	while ((parent = __atomic_load_n(&component[x], __ATOMIC_RELAXED)) != x)
 	{
-		//! Find the object with minimum degree whose
-		//! index has not yet been inserted to R
-		int min_degree = n + 1;
-		int min_degree_idx = -1;
+		//! Path halving. A node only ever points to a smaller one
+		//! of its component, so racing writes here are harmless
+		int grandparent = __atomic_load_n(&component[parent], __ATOMIC_RELAXED);
+		__atomic_store_n(&component[x], grandparent, __ATOMIC_RELAXED);
+		x = grandparent;
+	}
+
+	return x;
+}
+
+static void unite(int *component, int a, int b)
+{
+	while (1)
+	{
+		a = find_root(component, a);
+		b = find_root(component, b);
+		if (a == b)
+			return;
+
+		if (a < b)
+			swap(&a, &b);
+
+		//! Hang a under b, unless another thread has hung it meanwhile
+		int expected = a;
+		if (__atomic_compare_exchange_n(&component[a], &expected, b, 0,
+										__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			return;
+	}
+}
+
+/*
+**************************************************************************
+*    Level-synchronous traversal. Every node of the next level is       *
+*    assigned to its neighbor of the current level placed first in R   *
+*    (its parent). Sorting the level by parent position, then degree,   *
+*    then index, gives exactly the order in which the queue version     *
+*    would have inserted it, since the queue visits the parents in      *
+*    that order and inserts the children of each one by degree, with    *
+*    ties in increasing index. The level is then placed right after     *
+*    the current one, so that R itself holds the frontier               *
+**************************************************************************
+*/
+
+static RCMStatus cuthill_mckee_levels(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *R)
+{
+	Workspace *W = C->workspace;
+	int *inserted = workspaceAlloc(W, n); // Shows if the node is already inserted to R (0 or 1)
+	int *parent = workspaceAlloc(W, n);	  // Position in R of the parent of each node (INT_MAX if none yet)
+	int *index = workspaceAlloc(W, n);	  // Index of each node, the last key of the sort of a level
+
+	int max_degree = 0;
+	STATS_START(region);
+#pragma omp parallel for schedule(static) reduction(max : max_degree) num_threads(LOOP_THREADS) if (n > THRES_1)
+	for (int i = 0; i < n; i++)
+	{
+		inserted[i] = 0;
+		parent[i] = INT_MAX;
+		index[i] = i;
+		if (degrees[i] > max_degree)
+			max_degree = degrees[i];
+	}
+	STATS_REGION(region);
+
+	StartSelector S; // Nodes in increasing order of degree
+	initStartSelector(&S, degrees, n, workspaceAlloc(W, n), workspaceAlloc(W, n + 1));
+
+	int *scratch = workspaceAlloc(W, n);				// Working space of the sort of a level
+	int *neighbors = workspaceAlloc(W, max_degree + 1); // Neighbors of a single node
+
+	//! Working arrays of the search for pseudo-peripheral nodes
+	int *level = NULL; // Level of each node in the current level structure (-1 if none)
+	int *nodes = NULL; // Nodes of the current level structure, level by level
+	if (C->start_mode == RCM_START_PSEUDO_PERIPHERAL)
+	{
+		level = workspaceAlloc(W, n);
+		nodes = workspaceAlloc(W, n);
 
 		for (int i = 0; i < n; i++)
+			level[i] = -1;
+	}
+
+	//! Do the algorithm until R is full
+	int filled = 0;
+	while (filled < n)
+	{
+		//! Find the start node of the component, exactly as the queue version does
+		STATS_START(start);
+		int root = nextStartNode(&S, inserted);
+		if (level != NULL && degrees[root])
+			root = pseudo_peripheral_node(A, n, degrees, gather, root, level, nodes, neighbors);
+		STATS_STOP(start, RCM_PHASE_START);
+		if (root < 0)
+			return RCM_ERROR_OUT_OF_MEMORY;
+
+		R[filled] = root;
+		parent[root] = -1;
+		inserted[root] = 1;
+
+		int begin = filled;	 // first node of the current level
+		int end = filled + 1; // one past the last node of the current level
+		while (begin < end)
 		{
-			if ((degrees[i] < min_degree) && (inserted[i] == 0))
+			int tail = end;
+			int by_index = 0; // whether the new level has to be sorted by index too
+
+			if (end - begin > THRES_4)
 			{
-				min_degree = degrees[i];
-				min_degree_idx = i;
+				STATS_START(region);
+				tail = expand_rcm_level(A, n, degrees, gather, R, parent, begin, end);
+				STATS_REGION(region);
+				if (tail < 0)
+					return RCM_ERROR_OUT_OF_MEMORY;
+				by_index = 1;
 			}
+			else
+				//! Parents are visited in order, so the first to reach a node
+				//! is its parent, and each one adds its children by index
+				for (int i = begin; i < end; i++)
+				{
+					STATS_START(start);
+					int count = gather(A, n, degrees, R[i], neighbors);
+					STATS_STOP(start, RCM_PHASE_GATHER);
+					STATS_NEIGHBORS(count);
+
+					for (int k = 0; k < count; k++)
+						if (parent[neighbors[k]] == INT_MAX)
+						{
+							parent[neighbors[k]] = i;
+							R[tail++] = neighbors[k];
+						}
+				}
+
+			STATS_START(sort);
+			sort_level(R + end, tail - end, degrees, parent, by_index ? index : NULL, scratch);
+			STATS_STOP(sort, RCM_PHASE_SORT);
+
+			STATS_START(queue);
+#pragma omp parallel for schedule(static) num_threads(LOOP_THREADS) if (tail - end > THRES_1)
+			for (int i = end; i < tail; i++)
+				inserted[R[i]] = 1;
+			STATS_REGION(queue);
+			STATS_STOP(queue, RCM_PHASE_QUEUE);
+
+			begin = end;
+			end = tail;
 		}
 
-		//! Insert index of minimum degree object to R
-		enqueue(R, min_degree_idx);
-		inserted[min_degree_idx] = 1;
-		if (degrees[min_degree_idx])
+		filled = end;
+	}
+
+	return RCM_OK;
+}
+
+/*
+*********************************************************************
+*    Expand the level R[begin..end-1] in parallel. Every thread     *
+*    lowers the parent of the neighbors it meets to the position    *
+*    of the node it expands, with a compare-and-swap loop, and      *
+*    keeps the ones it reached first in its own list. A prefix      *
+*    sum of the list sizes then places the lists after the level.   *
+*    Returns one past the last node of the new level                *
+*********************************************************************
+*/
+
+static int expand_rcm_level(void *A, int n, int *degrees, gather_fn gather,
+							int *R, int *parent, int begin, int end)
+{
+	int max_threads = LEVEL_THREADS;
+	int offsets[max_threads + 1];
+
+	int tail = end;
+	int failed = 0;
+#pragma omp parallel num_threads(max_threads)
+	{
+		int t = omp_get_thread_num();
+		int num_threads = omp_get_num_threads();
+
+		int capacity = 64;			// capacity of the thread's list
+		int count = 0;				// nodes in the thread's list
+		int neighbors_capacity = 0; // capacity of the thread's neighbors buffer
+		int *list = malloc(capacity * sizeof(int));
+		int *neighbors = NULL;
+		int ok = (list != NULL); // whether the thread's buffers could be allocated
+
+#pragma omp for schedule(dynamic, 64)
+		for (int i = begin; i < end; i++)
 		{
-			//! Insert all of its neighbors (not already inserted to R)
-			//! to Q, sorted in increasing order of degree
-			add_neighbors_to_queue_parallel(X, n, degrees, inserted, Q, min_degree_idx,
-											last_neighbors[min_degree_idx]);
+			int node = R[i];
+			if (ok && degrees[node] > neighbors_capacity)
+			{
+				int *grown = realloc(neighbors, degrees[node] * sizeof(int));
+				if (grown != NULL)
+				{
+					neighbors = grown;
+					neighbors_capacity = degrees[node];
+				}
+				else
+					ok = 0;
+			}
+			if (!ok)
+				continue;
+
+			STATS_START(start);
+			int num_of_neigh = gather(A, n, degrees, node, neighbors);
+			STATS_STOP(start, RCM_PHASE_GATHER);
+			STATS_NEIGHBORS(num_of_neigh);
 
-			//! While Q is not empty, extract its first node. If this
-			//! node has not been inserted in R, add it to R and add
-			//! its neighbors in increasing order of degree to Q
-			while (!isEmpty(Q))
+			for (int k = 0; k < num_of_neigh; k++)
 			{
-				//! Remove the first element of Q
-				int removed_item = peek(Q);
-				dequeue(Q);
-
-				//! Insert index of this element to R
-				enqueue(R, removed_item);
-
-				//! If it has neighbors, add all of them (not already inserted
-				//! to R or Q) to Q, sorted in increasing order of degree
-				if (degrees[removed_item])
-					add_neighbors_to_queue_parallel(X, n, degrees, inserted, Q, removed_item,
-													last_neighbors[removed_item]);
+				//! Nodes of earlier levels always have a smaller parent
+				int old = __atomic_load_n(&parent[neighbors[k]], __ATOMIC_RELAXED);
+				while (i < old)
+					if (__atomic_compare_exchange_n(&parent[neighbors[k]], &old, i, 0,
+													__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+					{
+						if (old == INT_MAX)
+						{
+							if (count == capacity)
+							{
+								int *grown = realloc(list, 2 * capacity * sizeof(int));
+								if (grown == NULL)
+								{
+									ok = 0;
+									break;
+								}
+								list = grown;
+								capacity *= 2;
+							}
+							list[count++] = neighbors[k];
+						}
+						break;
+					}
 			}
 		}
+
+		if (!ok)
+		{
+			printf(RED "Error:" RESET_COLOR " Memory allocation for the list of a thread failed\n\n");
+#pragma omp atomic write
+			failed = 1;
+		}
+		offsets[t + 1] = count;
+
+#pragma omp barrier
+#pragma omp single
+		{
+			offsets[0] = end;
+			for (int i = 0; i < num_threads; i++)
+				offsets[i + 1] += offsets[i];
+			tail = offsets[num_threads];
+		}
+
+		if (count > 0)
+			memcpy(R + offsets[t], list, count * sizeof(int));
+
+		free(list);
+		free(neighbors);
 	}
 
-	//! Reverse R array
-	reverse_array(R->elements, n);
+	return failed ? -1 : tail;
+}
+
+/*
+************************************************************************
+*    Sort a new level by parent position, then degree, then index,     *
+*    with stable sorts from the least to the most significant key.     *
+*    If index is NULL the level is already in order of index within    *
+*    each parent, and that pass is skipped                             *
+************************************************************************
+*/
+
+static void sort_level(int *nodes, int num_nodes, int *degrees, int *parent, int *index, int *scratch)
+{
+	int *keys[3] = {index, degrees, parent};
+
+	for (int k = 0; k < 3; k++)
+	{
+		if (keys[k] == NULL)
+			continue;
+
+		//! If the level has more than THRES_3 nodes, then do it in parallel
+		if (num_nodes > THRES_3)
+			parallel_radix_sort(nodes, keys[k], num_nodes, scratch);
+		else
+			degreeSort(nodes, keys[k], num_nodes, scratch);
+	}
+}
+
+/*
+**************************************************************************
+*    George-Liu search for a pseudo-peripheral node: starting from       *
+*    root, build the level structure rooted at the node of minimum       *
+*    degree of the last level, for as long as that makes it deeper.      *
+*    Returns -1 if a level could not be expanded                         *
+**************************************************************************
+*/
+
+static int pseudo_peripheral_node(void *A, int n, int *degrees, gather_fn gather,
+								  int root, int *level, int *nodes, int *neighbors)
+{
+	int num_nodes;
+	int depth = level_structure(A, n, degrees, gather, root, level, nodes, neighbors, &num_nodes);
+	if (depth < 0)
+		return -1;
+
+	while (1)
+	{
+		//! The last level is at the end of nodes. Pick its node of minimum
+		//! degree (the smallest index among equal degrees) and clear levels
+		int candidate = -1;
+		for (int i = num_nodes - 1; i >= 0 && level[nodes[i]] == depth; i--)
+			if (candidate < 0 || degrees[nodes[i]] < degrees[candidate] ||
+				(degrees[nodes[i]] == degrees[candidate] && nodes[i] < candidate))
+				candidate = nodes[i];
+
+		STATS_START(region);
+#pragma omp parallel for schedule(static) num_threads(LOOP_THREADS) if (num_nodes > THRES_1)
+		for (int i = 0; i < num_nodes; i++)
+			level[nodes[i]] = -1;
+		STATS_REGION(region);
+
+		int candidate_depth = level_structure(A, n, degrees, gather, candidate, level, nodes, neighbors, &num_nodes);
+		if (candidate_depth < 0)
+			return -1;
+		if (candidate_depth <= depth)
+		{
+			STATS_START(clear);
+#pragma omp parallel for schedule(static) num_threads(LOOP_THREADS) if (num_nodes > THRES_1)
+			for (int i = 0; i < num_nodes; i++)
+				level[nodes[i]] = -1;
+			STATS_REGION(clear);
+
+			return root;
+		}
+
+		root = candidate;
+		depth = candidate_depth;
+	}
+}
+
+/*
+***********************************************************************
+*    Breadth-first search from root, storing the level of every       *
+*    node reached to level and the nodes themselves, level by level,  *
+*    to nodes. Returns the index of the last level, or -1 if a level  *
+*    could not be expanded                                            *
+*                                                                     *
+*    Levels wider than THRES_4 nodes are expanded in parallel. The    *
+*    order of the nodes inside such a level then depends on the       *
+*    threads, but the set of nodes of every level does not            *
+***********************************************************************
+*/
+
+static int level_structure(void *A, int n, int *degrees, gather_fn gather, int root,
+						   int *level, int *nodes, int *neighbors, int *num_nodes)
+{
+	int begin = 0; // first node of the current level
+	int end = 1;   // one past the last node of the current level
+	int depth = 0;
+
+	nodes[0] = root;
+	level[root] = 0;
+
+	while (1)
+	{
+		int tail = end;
+
+		if (end - begin > THRES_4)
+		{
+			STATS_START(region);
+			tail = expand_level(A, n, degrees, gather, level, nodes, begin, end, depth);
+			STATS_REGION(region);
+			if (tail < 0)
+				return -1;
+		}
+		else
+			tail = expand_level_serial(A, n, degrees, gather, level, nodes, neighbors, begin, end, depth);
+
+		//! Stop when the current level is the last one
+		if (tail == end)
+			break;
+
+		begin = end;
+		end = tail;
+		depth++;
+	}
+
+	*num_nodes = end;
+
+	return depth;
+}
+
+//! Expand the level nodes[begin..end-1] on the calling thread alone
+static int expand_level_serial(void *A, int n, int *degrees, gather_fn gather,
+							   int *level, int *nodes, int *neighbors, int begin, int end, int depth)
+{
+	int tail = end;
+
+	for (int i = begin; i < end; i++)
+	{
+		int count = gather(A, n, degrees, nodes[i], neighbors);
+
+		for (int k = 0; k < count; k++)
+			if (level[neighbors[k]] < 0)
+			{
+				level[neighbors[k]] = depth + 1;
+				nodes[tail++] = neighbors[k];
+			}
+	}
+
+	return tail;
+}
+
+/*
+*********************************************************************
+*    Expand the level nodes[begin..end-1] in parallel. Every        *
+*    thread claims unvisited neighbors with a compare-and-swap on   *
+*    their level and keeps them in its own list. A prefix sum of    *
+*    the list sizes then places the lists after the current level.  *
+*    Returns one past the last node of the new level                *
+*********************************************************************
+*/
+
+static int expand_level(void *A, int n, int *degrees, gather_fn gather,
+						int *level, int *nodes, int begin, int end, int depth)
+{
+	int max_threads = LEVEL_THREADS;
+	int offsets[max_threads + 1];
 
-	//! Free allocated memory
-	free(Q);
-	free(degrees);
-	free(inserted);
-	free(last_neighbors);
+	int tail = end;
+	int failed = 0;
+#pragma omp parallel num_threads(max_threads)
+	{
+		int t = omp_get_thread_num();
+		int num_threads = omp_get_num_threads();
+
+		int capacity = 64;			// capacity of the thread's list
+		int count = 0;				// nodes in the thread's list
+		int neighbors_capacity = 0; // capacity of the thread's neighbors buffer
+		int *list = malloc(capacity * sizeof(int));
+		int *neighbors = NULL;
+		int ok = (list != NULL); // whether the thread's buffers could be allocated
+
+#pragma omp for schedule(dynamic, 64)
+		for (int i = begin; i < end; i++)
+		{
+			int node = nodes[i];
+			if (ok && degrees[node] > neighbors_capacity)
+			{
+				int *grown = realloc(neighbors, degrees[node] * sizeof(int));
+				if (grown != NULL)
+				{
+					neighbors = grown;
+					neighbors_capacity = degrees[node];
+				}
+				else
+					ok = 0;
+			}
+			if (!ok)
+				continue;
 
-	return R->elements;
+			int num_of_neigh = gather(A, n, degrees, node, neighbors);
+			for (int k = 0; k < num_of_neigh; k++)
+			{
+				int expected = -1;
+				if (__atomic_load_n(&level[neighbors[k]], __ATOMIC_RELAXED) < 0 &&
+					__atomic_compare_exchange_n(&level[neighbors[k]], &expected, depth + 1, 0,
+												__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					if (count == capacity)
+					{
+						int *grown = realloc(list, 2 * capacity * sizeof(int));
+						if (grown == NULL)
+						{
+							ok = 0;
+							break;
+						}
+						list = grown;
+						capacity *= 2;
+					}
+					list[count++] = neighbors[k];
+				}
+			}
+		}
+
+		if (!ok)
+		{
+			printf(RED "Error:" RESET_COLOR " Memory allocation for the list of a thread failed\n\n");
+#pragma omp atomic write
+			failed = 1;
+		}
+		offsets[t + 1] = count;
+
+#pragma omp barrier
+#pragma omp single
+		{
+			offsets[0] = end;
+			for (int i = 0; i < num_threads; i++)
+				offsets[i + 1] += offsets[i];
+			tail = offsets[num_threads];
+		}
+
+		if (count > 0)
+			memcpy(nodes + offsets[t], list, count * sizeof(int));
+
+		free(list);
+		free(neighbors);
+	}
+
+	return failed ? -1 : tail;
 }
 
 /*
@@ -159,58 +1193,555 @@ int *rcm(int *X, int n)
 ***********************************************
 */
 
-void add_neighbors_to_queue_parallel(int *X, int n, int *degrees, int *inserted,
-									 Queue *Q, int element_idx, int last_neighbor_idx)
+int add_neighbors_to_queue_parallel(int *X, int n, int *degrees, int *inserted,
+									Queue *Q, int element_idx, int last_neighbor_idx, Workspace *W)
 {
+	int num_of_neigh = degrees[element_idx]; // number of neighbors
+
+	Workspace *temporary = NULL; // used when the caller gives no workspace
+	if (W == NULL)
+		W = temporary = createWorkspace(0);
+	size_t mark = W != NULL ? workspaceMark(W) : 0;
+	if (W == NULL || reserveWorkspace(W, mark + 2 * (size_t)num_of_neigh + 1) != 0)
+	{
+		freeWorkspace(temporary);
+		return -1;
+	}
+
 	//! Find all of its neighbors and store them to an array
-	//! Do it parallel only if n > 2000
+	int *neighbors = workspaceAlloc(W, num_of_neigh);
+	int *scratch = workspaceAlloc(W, num_of_neigh + 1);
+
+	STATS_START(start);
+	gather_dense_row(X, n, element_idx, last_neighbor_idx, neighbors);
+	STATS_STOP(start, RCM_PHASE_GATHER);
+	STATS_NEIGHBORS(num_of_neigh);
+
+	int failed = sort_and_enqueue(neighbors, num_of_neigh, degrees, inserted, Q, scratch);
+
+	workspaceRelease(W, mark);
+	freeWorkspace(temporary);
+
+	return failed;
+}
+
+int add_neighbors_to_queue_csr(RCMOffset *row_ptr, int *col_idx, int *degrees,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	CSR A = {0, 0, row_ptr, col_idx};
+	return add_neighbors_ws(&A, 0, degrees, gather_csr, inserted, Q, element_idx, W);
+}
+
+int add_neighbors_to_queue_bitset(BitMatrix *B, int *degrees,
+								  int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	return add_neighbors_ws(B, B->n, degrees, gather_bitset, inserted, Q, element_idx, W);
+}
+
+//! The public versions hold no pointer into the workspace,
+//! so they make room for the buffers there (or in a
+//! temporary one) first
+static int add_neighbors_ws(void *A, int n, int *degrees, gather_fn gather,
+							int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	Workspace *temporary = NULL; // used when the caller gives no workspace
+	if (W == NULL)
+		W = temporary = createWorkspace(0);
+	if (W == NULL || reserveWorkspace(W, workspaceMark(W) + 2 * (size_t)degrees[element_idx] + 1) != 0)
+	{
+		freeWorkspace(temporary);
+		return -1;
+	}
+
+	RCMStatus status = add_neighbors(A, n, degrees, gather, inserted, Q, element_idx, W);
+	freeWorkspace(temporary);
+
+	return (status == RCM_OK) ? 0 : -1;
+}
+
+//! The traversal reserves room for the buffers before it takes any
+//! pointer into the workspace, so they must fit without growing it,
+//! which would leave those pointers dangling. A queue that overflows
+//! means the matrix is not valid
+static RCMStatus add_neighbors(void *A, int n, int *degrees, gather_fn gather,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
 	int num_of_neigh = degrees[element_idx]; // number of neighbors
-	int *neighbors = malloc(num_of_neigh * sizeof(int));
-	if (neighbors == NULL)
+
+	//! Find all of its neighbors and store them to an array
+	size_t mark = workspaceMark(W);
+	int *neighbors = workspaceAlloc(W, num_of_neigh);
+	int *scratch = workspaceAlloc(W, num_of_neigh + 1);
+	if (neighbors == NULL || scratch == NULL)
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for 'neighbors' failed\n\n");
-		exit(1);
+		workspaceRelease(W, mark);
+		return RCM_ERROR_OUT_OF_MEMORY;
 	}
 
+	STATS_START(start);
+	gather(A, n, degrees, element_idx, neighbors);
+	STATS_STOP(start, RCM_PHASE_GATHER);
+	STATS_NEIGHBORS(num_of_neigh);
+
+	int overflow = sort_and_enqueue(neighbors, num_of_neigh, degrees, inserted, Q, scratch);
+
+	workspaceRelease(W, mark);
+
+	return overflow ? RCM_ERROR_INVALID_ARGUMENT : RCM_OK;
+}
+
+/*
+*******************************************************
+*    Functions that find the neighbors of a node,     *
+*    for each matrix format, in increasing order      *
+*******************************************************
+*/
+
+static int gather_dense(void *A, int n, int *degrees, int element_idx, int *neighbors)
+{
+	Dense *dense = (Dense *)A;
+	return gather_dense_row(dense->X, n, element_idx, dense->last_neighbors[element_idx], neighbors);
+}
+
+static int gather_dense_row(int *X, int n, int element_idx, int last_neighbor_idx, int *neighbors)
+{
+	//! Do it parallel only if n > THRES_2
+	int *row = X + (size_t)n * element_idx;
+	int length = last_neighbor_idx + 1;
+
+	if (n <= THRES_2)
+		return row_gather_nonzeros(row, 0, length, element_idx, neighbors);
+
+	//! Every thread takes a contiguous part of the row and counts its
+	//! neighbors there. A prefix sum of the counts gives the position
+	//! where each thread writes its own, so that they end up in
+	//! increasing order without any locking. The offsets live on the
+	//! stack, since this runs once for every node of the traversal
+	int max_threads = GATHER_THREADS;
+	int offsets[max_threads + 1];
+
 	int count = 0;
-	int j_;
-	if (n > THRES_2)
-#pragma omp parallel private(j_) num_threads(NUM_THREADS)
+	STATS_START(region);
+#pragma omp parallel num_threads(max_threads)
 	{
-#pragma omp for
-		for (j_ = 0; j_ < last_neighbor_idx + 1; j_++)
-			if ((X[n * element_idx + j_] == 1) && (j_ != element_idx))
-#pragma omp critical
-				neighbors[count++] = j_;
+		int t = omp_get_thread_num();
+		int num_threads = omp_get_num_threads();
+		int from = (int)((long)length * t / num_threads);
+		int to = (int)((long)length * (t + 1) / num_threads);
+
+		offsets[t + 1] = row_count_nonzeros(row + from, to - from, element_idx - from, NULL);
+
+#pragma omp barrier
+#pragma omp single
+		{
+			offsets[0] = 0;
+			for (int i = 0; i < num_threads; i++)
+				offsets[i + 1] += offsets[i];
+			count = offsets[num_threads];
+		}
+
+		row_gather_nonzeros(row, from, to, element_idx, neighbors + offsets[t]);
 	}
-	else
-		for (j_ = 0; j_ < last_neighbor_idx + 1; j_++)
-			if ((X[n * element_idx + j_] == 1) && (j_ != element_idx))
-				neighbors[count++] = j_;
+	STATS_REGION(region);
 
-	//! Sort the neighbors in increasing order of degree using quickSort
-	//! If the neighbors are more than 100, then do it in parallel, using 2 threads
-	if (num_of_neigh > THRES_3)
+	return count;
+}
+
+static int gather_csr(void *A, int n, int *degrees, int element_idx, int *neighbors)
+{
+	CSR *csr = (CSR *)A;
+
+	//! Copy its neighbors out of the row, skipping the diagonal.
+	//! A row holds only degree entries, so this is never worth
+	//! splitting among threads, unlike the dense row scan
+	int count = 0;
+	for (RCMOffset k = csr->row_ptr[element_idx]; k < csr->row_ptr[element_idx + 1]; k++)
+		if (csr->col_idx[k] != element_idx)
+			neighbors[count++] = csr->col_idx[k];
+
+	return count;
+}
+
+static int gather_bitset(void *A, int n, int *degrees, int element_idx, int *neighbors)
+{
+	BitMatrix *B = (BitMatrix *)A;
+
+	//! Extract its neighbors from the set bits of its row, in
+	//! increasing column order, skipping the diagonal
+	//! Do it parallel only if the row is longer than THRES_2 columns,
+	//! the unit it is calibrated in on dense rows, 64 to a word
+	uint64_t *row = B->bits + (size_t)element_idx * B->words_per_row;
+	int words = B->words_per_row;
+
+	if (64 * (long)words <= THRES_2)
+		return extract_bits(row, 0, words, element_idx, neighbors);
+
+	//! Every thread takes a contiguous range of words. The popcounts
+	//! of the ranges give the position where each thread writes its
+	//! neighbors, so they end up in increasing order without locking.
+	//! As for dense rows, the offsets live on the stack
+	int max_threads = GATHER_THREADS;
+	int offsets[max_threads + 1];
+
+	int count = 0;
+	STATS_START(region);
+#pragma omp parallel num_threads(max_threads)
 	{
-		int pi = partition(neighbors, degrees, 0, num_of_neigh - 1);
-#pragma omp parallel sections
+		int t = omp_get_thread_num();
+		int num_threads = omp_get_num_threads();
+		int from = (int)((long)words * t / num_threads);
+		int to = (int)((long)words * (t + 1) / num_threads);
+
+		int local = 0;
+		for (int w = from; w < to; w++)
+			local += __builtin_popcountll(row[w]);
+		if (element_idx / 64 >= from && element_idx / 64 < to)
+			local -= bitmatrix_get(B, element_idx, element_idx);
+		offsets[t + 1] = local;
+
+#pragma omp barrier
+#pragma omp single
 		{
-#pragma omp section
-			quickSort(neighbors, degrees, 0, pi - 1); // Thread 1
-#pragma omp section
-			quickSort(neighbors, degrees, pi + 1, num_of_neigh - 1); // Thread 2
+			offsets[0] = 0;
+			for (int i = 0; i < num_threads; i++)
+				offsets[i + 1] += offsets[i];
+			count = offsets[num_threads];
 		}
+
+		extract_bits(row, from, to, element_idx, neighbors + offsets[t]);
 	}
+	STATS_REGION(region);
+
+	return count;
+}
+
+/*
+*****************************************************************
+*    Store the columns of the set bits of words [from, to) of   *
+*    a row to neighbors, except for column skip (the diagonal)  *
+*****************************************************************
+*/
+
+static int extract_bits(uint64_t *row, int from, int to, int skip, int *neighbors)
+{
+	int count = 0;
+	for (int w = from; w < to; w++)
+	{
+		uint64_t word = row[w];
+		while (word)
+		{
+			int j = 64 * w + __builtin_ctzll(word);
+			word &= word - 1; // clear the lowest set bit
+
+			if (j != skip)
+				neighbors[count++] = j;
+		}
+	}
+
+	return count;
+}
+
+/*
+*************************************************************************
+*    Sort the neighbors in increasing order of degree (stable, so      *
+*    neighbors of equal degree keep their order) and insert those      *
+*    not already inserted to R or Q, to Q                              *
+*************************************************************************
+*/
+
+static int sort_and_enqueue(int *neighbors, int num_of_neigh, int *degrees,
+							int *inserted, Queue *Q, int *scratch)
+{
+	//! If the neighbors are more than THRES_3, then do it in parallel
+	STATS_START(sort);
+	if (num_of_neigh > THRES_3)
+		parallel_radix_sort(neighbors, degrees, num_of_neigh, scratch);
 	else
-		quickSort(neighbors, degrees, 0, num_of_neigh - 1);
+		degreeSort(neighbors, degrees, num_of_neigh, scratch);
+	STATS_STOP(sort, RCM_PHASE_SORT);
 
 	//! Insert all of its neighbors (not already inserted to R or Q) to Q
+	STATS_START(queue);
 	for (int i = 0; i < num_of_neigh; i++)
 		if (!inserted[neighbors[i]])
 		{
-			enqueue(Q, neighbors[i]);
+			if (enqueue(Q, neighbors[i]) != 0)
+				return -1;
 			inserted[neighbors[i]] = 1;
 		}
+	STATS_STOP(queue, RCM_PHASE_QUEUE);
 
-	free(neighbors);
-}
\ No newline at end of file
+	return 0;
+}
+
+/*
+**************************************************************************
+*    Parallel version of radixSort(). In every pass each thread counts   *
+*    the digits of its own contiguous chunk. Offsets are then assigned   *
+*    by digit first and by thread second, so that each thread scatters   *
+*    its chunk to disjoint slots and the sort stays stable               *
+**************************************************************************
+*/
+
+static void parallel_radix_sort(int *arr1, int *arr2, int n, int *scratch)
+{
+	int min = arr2[arr1[0]];
+	int max = min;
+	STATS_START(region);
+#pragma omp parallel for reduction(min : min) reduction(max : max) num_threads(SORT_THREADS)
+	for (int i = 0; i < n; i++)
+	{
+		int key = arr2[arr1[i]];
+		if (key < min)
+			min = key;
+		if (key > max)
+			max = key;
+	}
+	STATS_REGION(region);
+
+	//! The digit counts of every thread live on the stack
+	int max_threads = SORT_THREADS;
+	int counts[max_threads][256];
+
+	int *src = arr1;
+	int *dst = scratch;
+	unsigned range = max - min;
+
+	for (int shift = 0; shift < 32 && (range >> shift) > 0; shift += 8)
+	{
+		STATS_START(pass);
+#pragma omp parallel num_threads(max_threads)
+		{
+			int t = omp_get_thread_num();
+			int num_threads = omp_get_num_threads();
+			int from = (int)((long)n * t / num_threads);
+			int to = (int)((long)n * (t + 1) / num_threads);
+			int *count = counts[t];
+
+			for (int b = 0; b < 256; b++)
+				count[b] = 0;
+			for (int i = from; i < to; i++)
+				count[(unsigned)(arr2[src[i]] - min) >> shift & 0xff]++;
+
+#pragma omp barrier
+#pragma omp single
+			{
+				int offset = 0;
+				for (int b = 0; b < 256; b++)
+					for (int tt = 0; tt < num_threads; tt++)
+					{
+						int c = counts[tt][b];
+						counts[tt][b] = offset;
+						offset += c;
+					}
+			}
+
+			for (int i = from; i < to; i++)
+				dst[count[(unsigned)(arr2[src[i]] - min) >> shift & 0xff]++] = src[i];
+		}
+		STATS_REGION(pass);
+
+		int *temp = src;
+		src = dst;
+		dst = temp;
+	}
+
+	//! After an odd number of passes the result is in scratch
+	if (src != arr1)
+		memcpy(arr1, src, n * sizeof(int));
+}
+
+/*
+*************************************************************************
+*    Calibration. Every parallel phase is timed serially and on 2, 4,   *
+*    ... threads, for sizes from 16 to 2^20 elements. A phase runs on   *
+*    the fewest threads within 5% of the best time at the largest       *
+*    size, and in parallel from a bit below the smallest size after     *
+*    which that always beats the serial code. The components            *
+*    threshold is a matter of the graph, so it is left as it is         *
+*************************************************************************
+*/
+
+#define CALIBRATE_PHASES 4		 // loop, gather, sort, level
+#define CALIBRATE_MIN_SIZE 16	 // smallest number of elements timed
+#define CALIBRATE_SIZES 17		 // sizes from 2^4 to 2^20
+#define CALIBRATE_DEGREE 4		 // neighbors of every node of the level
+#define CALIBRATE_BUDGET 2.0e-3	 // seconds spent on every measurement
+#define CALIBRATE_TOLERANCE 1.05 // fewer threads are used if that close to the best
+#define CALIBRATE_MAX_THREADS 32 // thread counts tried (up to 2^31)
+
+void rcm_calibrate(RCMTuning *T)
+{
+	RCMTuning forced = tuning; // what the timed kernels of this thread read
+	active = &forced;
+	*T = tuning;
+
+	//! Thread counts 2, 4, 8, ... and all of them
+	int max_threads = NUM_THREADS;
+	int thread_counts[CALIBRATE_MAX_THREADS];
+	int num_counts = 0;
+	for (int t = 2; t < max_threads; t *= 2)
+		thread_counts[num_counts++] = t;
+	if (max_threads > 1)
+		thread_counts[num_counts++] = max_threads;
+
+	//! Room for the largest size: a level of size nodes that reaches
+	//! size more, a dense row, and the keys and buffers of the sort
+	int max_size = CALIBRATE_MIN_SIZE << (CALIBRATE_SIZES - 1);
+	RCMOffset *row_ptr = malloc((2 * max_size + 1) * sizeof(RCMOffset));
+	int *col_idx = malloc(CALIBRATE_DEGREE * max_size * sizeof(int));
+	int *keys = malloc(2 * max_size * sizeof(int));
+	int *nodes = malloc(2 * max_size * sizeof(int));
+	int *level = malloc(2 * max_size * sizeof(int));
+	int *buffer = malloc((max_size + 1) * sizeof(int));
+	//! Without them, T keeps the tuning in use
+	int phases = CALIBRATE_PHASES;
+	if (row_ptr == NULL || col_idx == NULL || keys == NULL || nodes == NULL || level == NULL || buffer == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Memory allocation for calibration failed\n\n");
+		phases = 0;
+	}
+
+	double serial[CALIBRATE_SIZES];
+	double parallel[CALIBRATE_SIZES][CALIBRATE_MAX_THREADS];
+	for (int phase = 0; phase < phases; phase++)
+	{
+		for (int s = 0; s < CALIBRATE_SIZES; s++)
+		{
+			int size = CALIBRATE_MIN_SIZE << s;
+
+			serial[s] = calibrate_phase(phase, size, 1, row_ptr, col_idx, keys, nodes, level, buffer);
+			for (int c = 0; c < num_counts; c++)
+				parallel[s][c] = calibrate_phase(phase, size, thread_counts[c], row_ptr, col_idx,
+												 keys, nodes, level, buffer);
+		}
+
+		//! The fewest threads that are close enough to the best
+		int last = CALIBRATE_SIZES - 1;
+		int best = 0;
+		for (int c = 1; c < num_counts; c++)
+			if (parallel[last][c] < parallel[last][best])
+				best = c;
+		for (int c = 0; c < best; c++)
+			if (parallel[last][c] <= CALIBRATE_TOLERANCE * parallel[last][best])
+			{
+				best = c;
+				break;
+			}
+
+		//! The smallest size from which they always win
+		int first = CALIBRATE_SIZES;
+		while (num_counts > 0 && first > 0 && parallel[first - 1][best] < serial[first - 1])
+			first--;
+
+		int threshold = INT_MAX;
+		int threads = 0;
+		if (first < CALIBRATE_SIZES)
+		{
+			threshold = (CALIBRATE_MIN_SIZE << first) / 4 * 3;
+			threads = (thread_counts[best] == max_threads) ? 0 : thread_counts[best];
+		}
+
+		switch (phase)
+		{
+		case 0:
+			T->loop_threshold = threshold;
+			T->loop_threads = threads;
+			break;
+		case 1:
+			T->gather_threshold = threshold;
+			T->gather_threads = threads;
+			break;
+		case 2:
+			T->sort_threshold = threshold;
+			T->sort_threads = threads;
+			break;
+		default:
+			T->level_threshold = threshold;
+			T->level_threads = threads;
+			break;
+		}
+	}
+
+	active = &tuning;
+
+	free(row_ptr);
+	free(col_idx);
+	free(keys);
+	free(nodes);
+	free(level);
+	free(buffer);
+}
+
+//! Best time of one phase on some elements and threads (1 for the
+//! serial code), over as many runs as fit in the budget
+static double calibrate_phase(int phase, int size, int threads, RCMOffset *row_ptr, int *col_idx,
+							  int *keys, int *nodes, int *level, int *buffer)
+{
+	//! Node i < size of the level reaches CALIBRATE_DEGREE nodes of the
+	//! next one, the other nodes have no neighbors
+	row_ptr[0] = 0;
+	for (int i = 0; i < 2 * size; i++)
+	{
+		row_ptr[i + 1] = row_ptr[i];
+		if (i < size)
+			for (int k = 0; k < CALIBRATE_DEGREE; k++)
+				col_idx[row_ptr[i + 1]++] = size + (int)(((long)i * 7 + k * 13) % size);
+	}
+	CSR A = {2 * size, row_ptr[2 * size], row_ptr, col_idx};
+
+	//! The keys are the dense row to gather, with one neighbor in
+	//! eight, the degrees to sort, spread over 1024 values, or the
+	//! degrees of the level
+	for (int i = 0; i < 2 * size; i++)
+		if (phase == 1)
+			keys[i] = (i % 8 == 0);
+		else if (phase == 2)
+			keys[i] = (int)((i * 2654435761u) >> 22);
+		else
+			keys[i] = (i < size) ? CALIBRATE_DEGREE : 0;
+
+	//! Force the serial or the parallel path, on the copy of the
+	//! tuning that rcm_calibrate() made
+	int parallel = threads > 1;
+	active->loop_threshold = active->gather_threshold = parallel ? 0 : INT_MAX;
+	active->loop_threads = active->gather_threads = threads;
+	active->sort_threads = active->level_threads = threads;
+
+	double best = DBL_MAX;
+	double spent = 0;
+	for (int run = 0; run < 3 || spent < CALIBRATE_BUDGET; run++)
+	{
+		//! Set up the input again, without timing it
+		if (phase == 2)
+			for (int i = 0; i < size; i++)
+				nodes[i] = i;
+		else if (phase == 3)
+			for (int i = 0; i < 2 * size; i++)
+			{
+				nodes[i] = i;
+				level[i] = (i < size) ? 0 : -1;
+			}
+
+		double start = omp_get_wtime();
+		if (phase == 0)
+			csr_degrees(row_ptr, col_idx, size, buffer);
+		else if (phase == 1)
+			gather_dense_row(keys, size, 0, size - 1, buffer);
+		else if (phase == 2 && parallel)
+			parallel_radix_sort(nodes, keys, size, buffer);
+		else if (phase == 2)
+			degreeSort(nodes, keys, size, buffer);
+		else if (parallel)
+			expand_level(&A, A.n, keys, gather_csr, level, nodes, 0, size, 0);
+		else
+			expand_level_serial(&A, A.n, keys, gather_csr, level, nodes, buffer, 0, size, 0);
+		double time = omp_get_wtime() - start;
+
+		spent += time;
+		if (time < best)
+			best = time;
+	}
+
+	return best;
+}
@@ -6,25 +6,254 @@
 */
 
 #include "../inc/rcm.h"
+#include "order.h"
+#include "stats.h"
+
+//! Number of columns of a dense row scanned at once when gathering neighbors
+#define GATHER_BLOCK 256
+
+//! Built with RCM_SEQUENTIAL_BACKEND, this file is the sequential backend
+//! of the OpenMP library, and only exports reorder_sequential()
+#ifndef RCM_SEQUENTIAL_BACKEND
+static int *reorder_new(void *A, int n, Format format, Workspace *W);
+#endif
+static RCMStatus reorder(RCMContext *C, void *A, int n, Format format, int *permutation);
+static RCMStatus cuthill_mckee(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation);
+static int pseudo_peripheral_node(void *A, int n, int *degrees, gather_fn gather,
+								  int root, int *level, int *nodes, int *neighbors);
+static int level_structure(void *A, int n, int *degrees, gather_fn gather, int root,
+						   int *level, int *nodes, int *neighbors, int *num_nodes);
+static RCMStatus add_neighbors(void *A, int n, int *degrees, gather_fn gather,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W);
+#ifndef RCM_SEQUENTIAL_BACKEND
+static int add_neighbors_ws(void *A, int n, int *degrees, gather_fn gather,
+							int *inserted, Queue *Q, int element_idx, Workspace *W);
+#endif
+static int gather_dense(void *A, int n, int *degrees, int element_idx, int *neighbors);
+static int gather_csr(void *A, int n, int *degrees, int element_idx, int *neighbors);
+static int gather_bitset(void *A, int n, int *degrees, int element_idx, int *neighbors);
+static int sort_and_enqueue(int *neighbors, int num_of_neigh, int *degrees,
+							int *inserted, Queue *Q, int *scratch);
+
+#ifdef RCM_SEQUENTIAL_BACKEND
+
+RCMStatus reorder_sequential(RCMContext *C, void *A, int n, Format format, int *permutation)
+{
+	return reorder(C, A, n, format, permutation);
+}
+
+#else
 
 int *rcm(int *X, int n)
 {
-	Queue *Q = createQueue(n);				 // Queue array
-	Queue *R = createQueue(n);				 // Result array
-	int *degrees = malloc(n * sizeof(int));	 // Array containing degree of all nodes
-	int *inserted = malloc(n * sizeof(int)); // Shows if the node is already inserted to R or Q (0 or 1)
+	return rcm_ws(X, n, NULL);
+}
+
+int *rcm_csr(RCMOffset *row_ptr, int *col_idx, int n)
+{
+	return rcm_csr_ws(row_ptr, col_idx, n, NULL);
+}
+
+int *rcm_bitset(BitMatrix *B)
+{
+	return rcm_bitset_ws(B, NULL);
+}
+
+int *rcm_ws(int *X, int n, Workspace *W)
+{
+	return reorder_new(X, n, FORMAT_DENSE, W);
+}
 
-	//! Check for malloc failures
-	if (degrees == NULL)
+int *rcm_csr_ws(RCMOffset *row_ptr, int *col_idx, int n, Workspace *W)
+{
+	CSR A = {n, row_ptr[n], row_ptr, col_idx};
+	return reorder_new(&A, n, FORMAT_CSR, W);
+}
+
+int *rcm_bitset_ws(BitMatrix *B, Workspace *W)
+{
+	return reorder_new(B, B->n, FORMAT_BITSET, W);
+}
+
+RCMStatus rcm_ctx(RCMContext *C, int *X, int n, int *permutation)
+{
+	if (C == NULL || X == NULL || n < 0 || permutation == NULL)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	return reorder(C, X, n, FORMAT_DENSE, permutation);
+}
+
+RCMStatus rcm_csr_ctx(RCMContext *C, RCMOffset *row_ptr, int *col_idx, int n, int *permutation)
+{
+	if (C == NULL || row_ptr == NULL || col_idx == NULL || n < 0 || permutation == NULL)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	CSR A = {n, row_ptr[n], row_ptr, col_idx};
+	return reorder(C, &A, n, FORMAT_CSR, permutation);
+}
+
+RCMStatus rcm_bitset_ctx(RCMContext *C, BitMatrix *B, int *permutation)
+{
+	if (C == NULL || B == NULL || permutation == NULL)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	return reorder(C, B, B->n, FORMAT_BITSET, permutation);
+}
+
+/*
+************************************************************************
+*    The functions without a context reorder on a temporary one,       *
+*    around the caller's workspace if there is one, into a new         *
+*    permutation. They return NULL on failure                          *
+************************************************************************
+*/
+
+static int *reorder_new(void *A, int n, Format format, Workspace *W)
+{
+	RCMContext C = {W, rcm_get_start_mode(), rcm_get_engine(), rcm_get_ordering(), rcm_get_backend()};
+	if (W == NULL)
+		C.workspace = createWorkspace(0);
+	int *permutation = malloc((n > 0 ? n : 1) * sizeof(int));
+
+	RCMStatus status = RCM_ERROR_OUT_OF_MEMORY;
+	if (C.workspace != NULL && permutation != NULL)
+		status = reorder(&C, A, n, format, permutation);
+
+	if (W == NULL)
+		freeWorkspace(C.workspace);
+
+	if (status != RCM_OK)
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for 'degrees' failed\n\n");
-		exit(1);
+		printf(RED "Error:" RESET_COLOR " Reordering failed: %s\n\n", rcm_status_string(status));
+		free(permutation);
+		return NULL;
 	}
-	if (inserted == NULL)
+
+	return permutation;
+}
+
+#endif
+
+/*
+************************************************************************
+*    Everything a reordering needs is taken from the workspace of the  *
+*    context, and given back at the end. It makes room for all of it   *
+*    at once, before taking any, since taken pointers are invalid      *
+*    once it grows: the degrees, the queue, the inserted flags, the    *
+*    start selector and its counters, the level structure of the       *
+*    pseudo-peripheral search along with its neighbor buffer, and the  *
+*    neighbors of a node along with their sorting space, n ints each   *
+*    at most. Sloan and GPS take their own arrays instead of those     *
+*    after the degrees                                                 *
+************************************************************************
+*/
+
+static RCMStatus reorder(RCMContext *C, void *A, int n, Format format, int *permutation)
+{
+	size_t need = FROM_PSEUDO_DIAMETER(C->ordering) ? n + ORDER_WORKSPACE(n) : 10 * (size_t)n + 3;
+
+	Workspace *W = C->workspace;
+	size_t mark = workspaceMark(W);
+	if (reserveWorkspace(W, mark + need) != 0)
+		return RCM_ERROR_OUT_OF_MEMORY;
+
+	int *degrees = workspaceAlloc(W, n); // Array containing degree of all nodes
+	gather_fn gather;
+	int invalid = 0; // entries out of range
+
+	//! Find degree of each node, not counting the diagonal
+	STATS_START(start);
+	if (format == FORMAT_DENSE)
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for 'inserted' failed\n\n");
-		exit(1);
+		//! Sum of non-diagonial elements of each corresponding row
+		int *X = (int *)A;
+		for (int i = 0; i < n; i++)
+			degrees[i] = row_count_nonzeros(X + (size_t)n * i, n, i, NULL);
+		gather = gather_dense;
+	}
+	else if (format == FORMAT_CSR)
+	{
+		//! Number of non-diagonial entries stored in each corresponding row,
+		//! all of whose columns must be in range
+		CSR *csr = (CSR *)A;
+		for (int i = 0; i < n; i++)
+		{
+			int degree = 0;
+
+			for (RCMOffset k = csr->row_ptr[i]; k < csr->row_ptr[i + 1]; k++)
+				if (csr->col_idx[k] < 0 || csr->col_idx[k] >= n)
+					invalid = 1;
+				else if (csr->col_idx[k] != i)
+					degree++;
+
+			degrees[i] = degree;
+		}
+		advise_mapped(csr->col_idx, RCM_ACCESS_RANDOM);
+		gather = gather_csr;
+	}
+	else
+	{
+		//! Number of set bits of each corresponding row, none of
+		//! which may lie past column n - 1
+		BitMatrix *B = (BitMatrix *)A;
+		uint64_t padding = (n % 64) ? ~0ULL << (n % 64) : 0;
+		for (int i = 0; i < n; i++)
+		{
+			uint64_t *row = B->bits + (size_t)i * B->words_per_row;
+			int degree = 0;
+
+			for (int w = 0; w < B->words_per_row; w++)
+				degree += __builtin_popcountll(row[w]);
+			if (row[B->words_per_row - 1] & padding)
+				invalid = 1;
+
+			degrees[i] = degree - bitmatrix_get(B, i, i);
+		}
+		advise_mapped(B->bits, RCM_ACCESS_RANDOM);
+		gather = gather_bitset;
 	}
+	STATS_STOP(start, RCM_PHASE_DEGREES);
+
+	RCMStatus status;
+	if (invalid)
+		status = RCM_ERROR_INVALID_ARGUMENT;
+	else if (C->ordering == RCM_ORDERING_SLOAN)
+		status = sloan(A, n, degrees, gather, C, permutation);
+	else if (C->ordering == RCM_ORDERING_GPS)
+		status = gibbs_poole_stockmeyer(A, n, degrees, gather, C, permutation);
+	else
+		status = cuthill_mckee(A, n, degrees, gather, C, permutation);
+
+	workspaceRelease(W, mark);
+
+	return status;
+}
+
+/*
+********************************************************************
+*    Traversal shared by all matrix formats. The degrees of all    *
+*    nodes must already be computed, and gather() knows how to     *
+*    find the neighbors of a node in the given matrix A            *
+********************************************************************
+*/
+
+static RCMStatus cuthill_mckee(void *A, int n, int *degrees, gather_fn gather, RCMContext *C, int *permutation)
+{
+	//! A node of a valid matrix has fewer than n neighbors, which
+	//! is all the room the buffers of the workspace have for them
+	int max_degree = 0;
+	for (int i = 0; i < n; i++)
+		if (degrees[i] > max_degree)
+			max_degree = degrees[i];
+	if (max_degree >= n && n > 0)
+		return RCM_ERROR_INVALID_ARGUMENT;
+
+	Workspace *W = C->workspace;
+	Queue Q = {n, 0, 0, -1, workspaceAlloc(W, n)}; // Queue array
+	Queue R = {n, 0, 0, -1, permutation};		   // Result array
+	int *inserted = workspaceAlloc(W, n);		   // Shows if the node is already inserted to R or Q (0 or 1)
+	StartSelector S;							   // Nodes in increasing order of degree
+	initStartSelector(&S, degrees, n, workspaceAlloc(W, n), workspaceAlloc(W, n + 1));
 
 	//! Initialize inserted array with zeros
 	for (int i = 0; i < n; i++)
@@ -32,75 +261,158 @@ int *rcm(int *X, int n)
 
 	//! Initialize R array with -1
 	for (int i = 0; i < n; i++)
-		R->elements[i] = -1;
+		R.elements[i] = -1;
 
-	//! Find degree of each node (sum of non-diagonial
-	//! elements of each corresponding row)
-	for (int i = 0; i < n; i++)
+	//! Working arrays of the search for pseudo-peripheral nodes
+	int *level = NULL;	   // Level of each node in the current level structure (-1 if none)
+	int *nodes = NULL;	   // Nodes of the current level structure, level by level
+	int *neighbors = NULL; // Neighbors of a single node
+	if (C->start_mode == RCM_START_PSEUDO_PERIPHERAL)
 	{
-		int degree = 0;
+		level = workspaceAlloc(W, n);
+		nodes = workspaceAlloc(W, n);
+		neighbors = workspaceAlloc(W, max_degree + 1);
 
-		for (int j = 0; j < n; j++)
-			if (X[n * i + j] && (j != i))
-				degree++;
-
-		degrees[i] = degree;
+		for (int i = 0; i < n; i++)
+			level[i] = -1;
 	}
 
 	//! Do the algorithm until R is full
-	while (!isFull(R))
+	while (!isFull(&R))
 	{
 		//! Find the object with minimum degree whose
 		//! index has not yet been inserted to R
-		int min_degree = n + 1;
-		int min_degree_idx = -1;
-		for (int i = 0; i < n; i++)
-		{
-			if ((degrees[i] < min_degree) && (inserted[i] == 0))
-			{
-				min_degree = degrees[i];
-				min_degree_idx = i;
-			}
-		}
+		STATS_START(start);
+		int min_degree_idx = nextStartNode(&S, inserted);
+
+		//! In that mode, start from a pseudo-peripheral
+		//! node of the component instead
+		if (level != NULL && degrees[min_degree_idx])
+			min_degree_idx = pseudo_peripheral_node(A, n, degrees, gather, min_degree_idx,
+													level, nodes, neighbors);
+		STATS_STOP(start, RCM_PHASE_START);
 
 		//! Insert index of minimum degree object to R
-		enqueue(R, min_degree_idx);
+		STATS_START(queue);
+		if (enqueue(&R, min_degree_idx) != 0)
+			return RCM_ERROR_INVALID_ARGUMENT;
 		inserted[min_degree_idx] = 1;
+		STATS_STOP(queue, RCM_PHASE_QUEUE);
 		if (degrees[min_degree_idx])
 		{
 			//! Insert all of its neighbors (not already inserted to R or Q)
 			//! to Q, sorted in increasing order of degree
-			add_neighbors_to_queue(X, n, degrees, inserted, Q, min_degree_idx);
+			RCMStatus status = add_neighbors(A, n, degrees, gather, inserted, &Q, min_degree_idx, W);
+			if (status != RCM_OK)
+				return status;
 
 			//! While Q is not empty, extract its first node. If this
 			//! node has not been inserted in R, add it to R and add
 			//! its neighbors in increasing order of degree to Q
-			while (!isEmpty(Q))
+			while (!isEmpty(&Q))
 			{
 				//! Remove the first element of Q
-				int removed_item = peek(Q);
-				dequeue(Q);
+				STATS_START(queue);
+				int removed_item = peek(&Q);
+				dequeue(&Q);
 
 				//! Insert index of this element to R
-				enqueue(R, removed_item);
+				if (enqueue(&R, removed_item) != 0)
+					return RCM_ERROR_INVALID_ARGUMENT;
+				STATS_STOP(queue, RCM_PHASE_QUEUE);
 
 				//! If it has neighbors, add all of them (not already inserted
 				//! to R or Q) to Q, sorted in increasing order of degree
 				if (degrees[removed_item])
-					add_neighbors_to_queue(X, n, degrees, inserted, Q, removed_item);
+				{
+					status = add_neighbors(A, n, degrees, gather, inserted, &Q, removed_item, W);
+					if (status != RCM_OK)
+						return status;
+				}
 			}
 		}
 	}
 
-	//! Reverse R array
-	reverse_array(R->elements, n);
+	//! Reverse R array, unless plain Cuthill-McKee was asked for
+	if (C->ordering != RCM_ORDERING_CM)
+		reverse_array(R.elements, n);
+
+	return RCM_OK;
+}
+
+/*
+**************************************************************************
+*    George-Liu search for a pseudo-peripheral node: starting from       *
+*    root, build the level structure rooted at the node of minimum       *
+*    degree of the last level, for as long as that makes it deeper       *
+**************************************************************************
+*/
+
+static int pseudo_peripheral_node(void *A, int n, int *degrees, gather_fn gather,
+								  int root, int *level, int *nodes, int *neighbors)
+{
+	int num_nodes;
+	int depth = level_structure(A, n, degrees, gather, root, level, nodes, neighbors, &num_nodes);
+
+	while (1)
+	{
+		//! The last level is at the end of nodes. Pick its node of minimum
+		//! degree (the smallest index among equal degrees) and clear levels
+		int candidate = -1;
+		for (int i = num_nodes - 1; i >= 0 && level[nodes[i]] == depth; i--)
+			if (candidate < 0 || degrees[nodes[i]] < degrees[candidate] ||
+				(degrees[nodes[i]] == degrees[candidate] && nodes[i] < candidate))
+				candidate = nodes[i];
+		for (int i = 0; i < num_nodes; i++)
+			level[nodes[i]] = -1;
+
+		int candidate_depth = level_structure(A, n, degrees, gather, candidate, level, nodes, neighbors, &num_nodes);
+		if (candidate_depth <= depth)
+		{
+			for (int i = 0; i < num_nodes; i++)
+				level[nodes[i]] = -1;
+
+			return root;
+		}
+
+		root = candidate;
+		depth = candidate_depth;
+	}
+}
+
+/*
+***********************************************************************
+*    Breadth-first search from root, storing the level of every       *
+*    node reached to level and the nodes themselves, level by level,  *
+*    to nodes. Returns the index of the last level                    *
+***********************************************************************
+*/
+
+static int level_structure(void *A, int n, int *degrees, gather_fn gather, int root,
+						   int *level, int *nodes, int *neighbors, int *num_nodes)
+{
+	int head = 0;
+	int tail = 0;
+
+	nodes[tail++] = root;
+	level[root] = 0;
 
-	//! Free allocated memory
-	free(Q);
-	free(degrees);
-	free(inserted);
+	while (head < tail)
+	{
+		int node = nodes[head++];
+		int count = gather(A, n, degrees, node, neighbors);
 
-	return R->elements;
+		for (int i = 0; i < count; i++)
+			if (level[neighbors[i]] < 0)
+			{
+				level[neighbors[i]] = level[node] + 1;
+				nodes[tail++] = neighbors[i];
+			}
+	}
+
+	*num_nodes = tail;
+
+	return level[nodes[tail - 1]];
 }
 
 /*
@@ -109,39 +421,170 @@ int *rcm(int *X, int n)
 ***********************************************
 */
 
-void add_neighbors_to_queue(int *X, int n, int *degrees,
-							int *inserted, Queue *Q, int element_idx)
+#ifndef RCM_SEQUENTIAL_BACKEND
+
+int add_neighbors_to_queue(int *X, int n, int *degrees,
+						   int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	return add_neighbors_ws(X, n, degrees, gather_dense, inserted, Q, element_idx, W);
+}
+
+int add_neighbors_to_queue_csr(RCMOffset *row_ptr, int *col_idx, int *degrees,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	CSR A = {0, 0, row_ptr, col_idx};
+	return add_neighbors_ws(&A, 0, degrees, gather_csr, inserted, Q, element_idx, W);
+}
+
+int add_neighbors_to_queue_bitset(BitMatrix *B, int *degrees,
+								  int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	return add_neighbors_ws(B, B->n, degrees, gather_bitset, inserted, Q, element_idx, W);
+}
+
+//! The public versions hold no pointer into the workspace,
+//! so they make room for the buffers there (or in a
+//! temporary one) first
+static int add_neighbors_ws(void *A, int n, int *degrees, gather_fn gather,
+							int *inserted, Queue *Q, int element_idx, Workspace *W)
+{
+	Workspace *temporary = NULL; // used when the caller gives no workspace
+	if (W == NULL)
+		W = temporary = createWorkspace(0);
+	if (W == NULL || reserveWorkspace(W, workspaceMark(W) + 2 * (size_t)degrees[element_idx] + 1) != 0)
+	{
+		freeWorkspace(temporary);
+		return -1;
+	}
+
+	RCMStatus status = add_neighbors(A, n, degrees, gather, inserted, Q, element_idx, W);
+	freeWorkspace(temporary);
+
+	return (status == RCM_OK) ? 0 : -1;
+}
+#endif
+
+//! The traversal reserves room for the buffers before it takes any
+//! pointer into the workspace, so they must fit without growing it,
+//! which would leave those pointers dangling. A queue that overflows
+//! means the matrix is not valid
+static RCMStatus add_neighbors(void *A, int n, int *degrees, gather_fn gather,
+							   int *inserted, Queue *Q, int element_idx, Workspace *W)
 {
-	//! Find all of its neighbors and store them to an array
 	int num_of_neigh = degrees[element_idx]; // number of neighbors
-	int *neighbors = malloc(num_of_neigh * sizeof(int));
-	if (neighbors == NULL)
+
+	//! Find all of its neighbors and store them to an array
+	size_t mark = workspaceMark(W);
+	int *neighbors = workspaceAlloc(W, num_of_neigh);
+	int *scratch = workspaceAlloc(W, num_of_neigh + 1);
+	if (neighbors == NULL || scratch == NULL)
 	{
-		printf(RED "Error:" RESET_COLOR " Memory allocation for 'neighbors' failed\n\n");
-		exit(1);
+		workspaceRelease(W, mark);
+		return RCM_ERROR_OUT_OF_MEMORY;
 	}
 
+	STATS_START(start);
+	gather(A, n, degrees, element_idx, neighbors);
+	STATS_STOP(start, RCM_PHASE_GATHER);
+	STATS_NEIGHBORS(num_of_neigh);
+
+	int overflow = sort_and_enqueue(neighbors, num_of_neigh, degrees, inserted, Q, scratch);
+
+	workspaceRelease(W, mark);
+
+	return overflow ? RCM_ERROR_INVALID_ARGUMENT : RCM_OK;
+}
+
+/*
+*******************************************************
+*    Functions that find the neighbors of a node,     *
+*    for each matrix format, in increasing order      *
+*******************************************************
+*/
+
+static int gather_dense(void *A, int n, int *degrees, int element_idx, int *neighbors)
+{
+	int *X = (int *)A;
+
+	//! The row is scanned in blocks, so that the scan
+	//! stops soon after the last neighbor has been found
+	int count = 0;
+	for (int j = 0; j < n && count < degrees[element_idx]; j += GATHER_BLOCK)
+		count += row_gather_nonzeros(X + (size_t)n * element_idx, j, (j + GATHER_BLOCK < n) ? j + GATHER_BLOCK : n,
+									 element_idx, neighbors + count);
+
+	return count;
+}
+
+static int gather_csr(void *A, int n, int *degrees, int element_idx, int *neighbors)
+{
+	CSR *csr = (CSR *)A;
+
+	//! Copy its neighbors out of the row, skipping the diagonal
 	int count = 0;
-	for (int j = 0; j < n; j++)
+	for (RCMOffset k = csr->row_ptr[element_idx]; k < csr->row_ptr[element_idx + 1]; k++)
+		if (csr->col_idx[k] != element_idx)
+			neighbors[count++] = csr->col_idx[k];
+
+	return count;
+}
+
+static int gather_bitset(void *A, int n, int *degrees, int element_idx, int *neighbors)
+{
+	BitMatrix *B = (BitMatrix *)A;
+
+	//! Extract its neighbors from the set bits of its row, in
+	//! increasing column order, skipping the diagonal
+	uint64_t *row = B->bits + (size_t)element_idx * B->words_per_row;
+	int count = 0;
+	for (int w = 0; w < B->words_per_row && count < degrees[element_idx]; w++)
 	{
-		if ((X[n * element_idx + j] == 1) && (j != element_idx))
+		uint64_t word = row[w];
+		while (word)
 		{
-			neighbors[count++] = j;
-			if (count == num_of_neigh)
-				break;
+			int j = 64 * w + __builtin_ctzll(word);
+			word &= word - 1; // clear the lowest set bit
+
+			if (j != element_idx)
+				neighbors[count++] = j;
 		}
 	}
 
-	//! Sort the neighbors in increasing order of degree using quickSort
-	quickSort(neighbors, degrees, 0, num_of_neigh - 1);
+	return count;
+}
+
+/*
+*************************************************************************
+*    Sort the neighbors in increasing order of degree (stable, so      *
+*    neighbors of equal degree keep their order) and insert those      *
+*    not already inserted to R or Q, to Q                              *
+*************************************************************************
+*/
+
+static int sort_and_enqueue(int *neighbors, int num_of_neigh, int *degrees,
+							int *inserted, Queue *Q, int *scratch)
+{
+	STATS_START(sort);
+	degreeSort(neighbors, degrees, num_of_neigh, scratch);
+	STATS_STOP(sort, RCM_PHASE_SORT);
 
-	//! Insert all of its neighbors (not already inserted to R or Q) to Q
+	STATS_START(queue);
 	for (int i = 0; i < num_of_neigh; i++)
 		if (!inserted[neighbors[i]])
 		{
-			enqueue(Q, neighbors[i]);
+			if (enqueue(Q, neighbors[i]) != 0)
+				return -1;
 			inserted[neighbors[i]] = 1;
 		}
+	STATS_STOP(queue, RCM_PHASE_QUEUE);
+
+	return 0;
+}
 
-	free(neighbors);
-}
\ No newline at end of file
+#ifndef RCM_SEQUENTIAL_BACKEND
+//! Nothing runs in parallel here, so there is nothing to calibrate
+void rcm_calibrate(RCMTuning *T)
+{
+	rcm_get_tuning(T);
+}
+#endif
@@ -0,0 +1,138 @@
+/*
+*******************************************************
+*    Where the time goes inside the rcm functions     *
+*******************************************************
+*/
+
+#include "stats.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+RCMStats *stats_collector = NULL;
+
+static const char *phase_names[RCM_NUM_PHASES] = {"degrees", "start", "gather", "sort", "queue"};
+
+static double stats_begin(RCMStats *stats);
+static void stats_end(RCMStats *stats, double start);
+static int stats_slot(void);
+
+/*
+******************************************************************
+*    The rcm functions, collecting stats for the whole call      *
+******************************************************************
+*/
+
+int *rcm_stats(int *X, int n, RCMStats *stats)
+{
+	double start = stats_begin(stats);
+	int *R = rcm_ws(X, n, NULL);
+	stats_end(stats, start);
+
+	return R;
+}
+
+int *rcm_csr_stats(RCMOffset *row_ptr, int *col_idx, int n, RCMStats *stats)
+{
+	double start = stats_begin(stats);
+	int *R = rcm_csr_ws(row_ptr, col_idx, n, NULL);
+	stats_end(stats, start);
+
+	return R;
+}
+
+int *rcm_bitset_stats(BitMatrix *B, RCMStats *stats)
+{
+	double start = stats_begin(stats);
+	int *R = rcm_bitset_ws(B, NULL);
+	stats_end(stats, start);
+
+	return R;
+}
+
+const char *rcm_phase_name(RCMPhase phase)
+{
+	return (phase >= 0 && phase < RCM_NUM_PHASES) ? phase_names[phase] : "unknown";
+}
+
+static double stats_begin(RCMStats *stats)
+{
+	if (stats == NULL)
+		return 0;
+
+	memset(stats, 0, sizeof(RCMStats));
+	stats_collector = stats;
+
+	return stats_clock();
+}
+
+static void stats_end(RCMStats *stats, double start)
+{
+	if (stats == NULL)
+		return;
+
+	stats->total_time = stats_clock() - start;
+	stats_collector = NULL;
+
+	for (int t = 0; t < RCM_STATS_THREADS; t++)
+		for (int p = 0; p < RCM_NUM_PHASES; p++)
+			if (stats->calls[t][p])
+				stats->threads = t + 1;
+}
+
+/*
+***************************************************************
+*    Hooks. Several threads may share a slot (tasks, nested   *
+*    regions or more threads than slots), so updates are      *
+*    atomic. They only run while stats are collected          *
+***************************************************************
+*/
+
+void stats_add_phase(RCMPhase phase, double start)
+{
+	double elapsed = stats_clock() - start;
+	int t = stats_slot();
+
+#pragma omp atomic
+	stats_collector->time[t][phase] += elapsed;
+#pragma omp atomic
+	stats_collector->calls[t][phase]++;
+}
+
+void stats_add_region(double start)
+{
+	//! Regions nested in a running one are part of its time already
+#ifdef _OPENMP
+	if (omp_get_level() > 0)
+		return;
+#endif
+
+	double elapsed = stats_clock() - start;
+
+#pragma omp atomic
+	stats_collector->region_time += elapsed;
+#pragma omp atomic
+	stats_collector->regions++;
+}
+
+void stats_add_neighbors(int count)
+{
+	//! Bins as the row bandwidths of Metrics
+	int bin = count ? 32 - __builtin_clz(count) : 0;
+
+#pragma omp atomic
+	stats_collector->neighbors[bin]++;
+}
+
+//! The thread of the outermost team, so that work done inside a
+//! nested (usually serialized) region counts for the thread doing it
+static int stats_slot(void)
+{
+#ifdef _OPENMP
+	int t = (omp_get_level() > 0) ? omp_get_ancestor_thread_num(1) : 0;
+	return (t < RCM_STATS_THREADS) ? t : RCM_STATS_THREADS - 1;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,58 @@
+/*
+*******************************************************
+*    Hooks of the instrumentation (see RCMStats).     *
+*    Private to the library, not installed            *
+*******************************************************
+*/
+
+#ifndef RCM_STATS_H
+#define RCM_STATS_H
+
+#include "../inc/rcm.h"
+
+//! The stats being filled, or NULL when nobody asked for them
+extern RCMStats *stats_collector;
+
+#ifdef RCM_NO_STATS
+#define STATS_ON 0
+#else
+#define STATS_ON __builtin_expect(stats_collector != NULL, 0)
+#endif
+
+//! STATS_START(t) declares t and starts timing if stats are collected.
+//! STATS_STOP(t, phase) adds the time since to phase on this thread,
+//! STATS_REGION(t) to the time in parallel regions, and
+//! STATS_NEIGHBORS(count) a neighbor list to the histogram
+#define STATS_START(t) double t = STATS_ON ? stats_clock() : 0
+#define STATS_STOP(t, phase)               \
+	do                                     \
+	{                                      \
+		if (STATS_ON)                      \
+			stats_add_phase((phase), (t)); \
+	} while (0)
+#define STATS_REGION(t)            \
+	do                             \
+	{                              \
+		if (STATS_ON)              \
+			stats_add_region((t)); \
+	} while (0)
+#define STATS_NEIGHBORS(count)            \
+	do                                    \
+	{                                     \
+		if (STATS_ON)                     \
+			stats_add_neighbors((count)); \
+	} while (0)
+
+static inline double stats_clock(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec + now.tv_nsec / 1.0e9;
+}
+
+void stats_add_phase(RCMPhase phase, double start);
+void stats_add_region(double start);
+void stats_add_neighbors(int count);
+
+#endif
@@ -0,0 +1,135 @@
+/*
+*****************************************************************
+*    Thresholds for parallelism, and their configuration file    *
+*****************************************************************
+*/
+
+#include <ctype.h>
+#include <limits.h>
+#include <stddef.h>
+#include "tuning.h"
+
+//! The values tuned on a 4-core i7-7500U, until calibrated or loaded
+RCMTuning tuning = {
+	.loop_threshold = 2000,
+	.gather_threshold = 1000,
+	.sort_threshold = 10000,
+	.level_threshold = 1000,
+	.component_threshold = 100000,
+	.loop_threads = 0,
+	.gather_threads = 0,
+	.sort_threads = 0,
+	.level_threads = 0,
+};
+
+//! Name and place of every field, in the order of the file
+typedef struct Field
+{
+	const char *name;
+	size_t offset;
+} Field;
+
+static const Field fields[] = {
+	{"loop_threshold", offsetof(RCMTuning, loop_threshold)},
+	{"gather_threshold", offsetof(RCMTuning, gather_threshold)},
+	{"sort_threshold", offsetof(RCMTuning, sort_threshold)},
+	{"level_threshold", offsetof(RCMTuning, level_threshold)},
+	{"component_threshold", offsetof(RCMTuning, component_threshold)},
+	{"loop_threads", offsetof(RCMTuning, loop_threads)},
+	{"gather_threads", offsetof(RCMTuning, gather_threads)},
+	{"sort_threads", offsetof(RCMTuning, sort_threads)},
+	{"level_threads", offsetof(RCMTuning, level_threads)},
+};
+
+#define NUM_FIELDS (int)(sizeof(fields) / sizeof(fields[0]))
+
+void rcm_set_tuning(const RCMTuning *T)
+{
+	tuning = *T;
+}
+
+void rcm_get_tuning(RCMTuning *T)
+{
+	*T = tuning;
+}
+
+/*
+*************************************************************************
+*    The file holds one "name = value" line for every field, in any     *
+*    order. Fields not in it keep their current value. Blank lines      *
+*    and everything after a '#' are ignored                             *
+*************************************************************************
+*/
+
+int rcm_load_tuning(const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s'\n\n", filename);
+		return -1;
+	}
+
+	RCMTuning loaded = tuning;
+	char line[256];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		line_number++;
+
+		char *comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		char name[64];
+		long value;
+		char *p = line;
+		while (isspace((unsigned char)*p))
+			p++;
+		if (*p == '\0')
+			continue;
+
+		int field = -1;
+		if (sscanf(p, "%63[a-z_] = %ld", name, &value) == 2)
+			for (int f = 0; f < NUM_FIELDS; f++)
+				if (strcmp(name, fields[f].name) == 0)
+					field = f;
+
+		if (field < 0 || value < 0 || value > INT_MAX)
+		{
+			printf(RED "Error:" RESET_COLOR " Invalid line %d in '%s'\n\n", line_number, filename);
+			fclose(fp);
+			return -1;
+		}
+
+		*(int *)((char *)&loaded + fields[field].offset) = (int)value;
+	}
+	fclose(fp);
+
+	tuning = loaded;
+
+	return 0;
+}
+
+int rcm_save_tuning(const char *filename, const RCMTuning *T)
+{
+	FILE *fp = fopen(filename, "w");
+	if (fp == NULL)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", filename);
+		return -1;
+	}
+
+	fprintf(fp, "# Thresholds for parallelism of the rcm functions (see RCMTuning)\n");
+	fprintf(fp, "# Threads 0 means all of them (omp_get_max_threads())\n");
+	for (int f = 0; f < NUM_FIELDS; f++)
+		fprintf(fp, "%s = %d\n", fields[f].name, *(const int *)((const char *)T + fields[f].offset));
+
+	if (fclose(fp) != 0)
+	{
+		printf(RED "Error:" RESET_COLOR " Could not write '%s'\n\n", filename);
+		return -1;
+	}
+
+	return 0;
+}
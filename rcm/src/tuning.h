@@ -0,0 +1,15 @@
+/*
+*******************************************************
+*    Thresholds and threads in use (see RCMTuning).   *
+*    Private to the library, not installed            *
+*******************************************************
+*/
+
+#ifndef RCM_TUNING_H
+#define RCM_TUNING_H
+
+#include "../inc/rcm.h"
+
+extern RCMTuning tuning;
+
+#endif
@@ -0,0 +1,645 @@
+/*
+***************************************
+*      - Reverse Cuthill McKee -      *
+*     SpMV payoff of the ordering     *
+***************************************
+*/
+
+#include "rcm.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#define LIBRARY "openmp"
+#else
+#define LIBRARY "sequential"
+#endif
+
+#define MAX_VALUES 64
+
+//! The simulated cache, see x_miss_rate()
+#define LINE_BYTES 64
+#define WAYS 8
+
+//! A comma separated list of values given on the command line
+typedef struct List
+{
+    int count;
+    double values[MAX_VALUES];
+} List;
+
+//! One matrix at one thread count, before ([0]) and after ([1]) reordering
+typedef struct Result
+{
+    const char *graph;
+    const char *order;
+    int n;
+    long long nnz;
+    double density;
+    int threads;
+    int seed;
+    int bandwidth[2];
+    double x_lines[2];    // distinct cache lines of x read per row
+    double miss_rate[2];  // of the reads of x, in the simulated cache
+    double spmv_time[2];  // median seconds per product
+    double gflops[2];
+    double reorder_time;  // rcm_csr() and permute_csr(), median seconds
+    long long break_even; // products that pay for the reordering, -1 if none
+} Result;
+
+//! What is measured, from the command line
+typedef struct Options
+{
+    int products;
+    int repetitions;
+    int warmup;
+    int cache_kb;
+} Options;
+
+void usage(const char *name);
+const char *engine_name(void);
+const char *backend_name(void);
+void parse_list(const char *str, List *list);
+int parse_graphs(const char *str, List *list);
+int *random_permutation(int n, uint64_t seed);
+double *ones(RCMOffset count);
+void spmv(CSR *A, const double *values, const double *x, double *y);
+double time_spmv(CSR *A, Options *O, double *times);
+double time_reorder(CSR *A, Options *O, double *times);
+double x_lines_per_row(CSR *A);
+double x_miss_rate(CSR *A, int cache_kb);
+double seconds(struct timespec *start, struct timespec *end);
+double median(double *times, int count);
+int compare_double(const void *a, const void *b);
+void measure(CSR *A, Result *R, List *threads, Options *O, double *times, Result *results, int *count);
+void write_csv(FILE *fp, Result *results, int count, Options *O);
+void write_json(FILE *fp, Result *results, int count, Options *O);
+
+int main(int argc, char *argv[])
+{
+    List sizes, densities, threads, seeds, graphs, orders;
+    parse_list("250000", &sizes);
+    parse_list("0.002", &densities);
+    parse_list("1,2,4", &threads);
+    parse_list("1", &seeds);
+    parse_graphs("grid2d,grid3d,random,powerlaw", &graphs);
+    orders.count = 1; // shuffled
+    orders.values[0] = 1;
+    Options O = {100, 5, 1, 256};
+    char *file = NULL;
+    char *output = NULL;
+
+    //! The start mode, the engine, the ordering and the backend are picked as in main()
+    char *start = getenv("RCM_START");
+    if (start != NULL && strcmp(start, "peripheral") == 0)
+        rcm_set_start_mode(RCM_START_PSEUDO_PERIPHERAL);
+
+    char *engine = getenv("RCM_ENGINE");
+    if (engine != NULL && strcmp(engine, "levels") == 0)
+        rcm_set_engine(RCM_ENGINE_LEVELS);
+    else if (engine != NULL && strcmp(engine, "components") == 0)
+        rcm_set_engine(RCM_ENGINE_COMPONENTS);
+
+    char *ordering = getenv("RCM_ORDERING");
+    if (ordering != NULL)
+    {
+        int o = rcm_ordering_from_name(ordering);
+        if (o < 0)
+        {
+            printf(RED "Error:" RESET_COLOR " Unknown ordering '%s'\n\n", ordering);
+            return 1;
+        }
+        rcm_set_ordering((RCMOrdering)o);
+    }
+
+    char *backend = getenv("RCM_BACKEND");
+    if (backend != NULL && strcmp(backend, "sequential") == 0)
+        rcm_set_backend(RCM_BACKEND_SEQUENTIAL);
+
+    //! And so is the family of the matrices, unless -g lists them
+    char *family = getenv("RCM_GRAPH");
+    if (family != NULL && parse_graphs(family, &graphs) != 0)
+        return 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:t:s:g:O:f:k:r:w:c:o:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            parse_list(optarg, &sizes);
+            break;
+        case 'd':
+            parse_list(optarg, &densities);
+            break;
+        case 't':
+            parse_list(optarg, &threads);
+            break;
+        case 's':
+            parse_list(optarg, &seeds);
+            break;
+        case 'g':
+            if (parse_graphs(optarg, &graphs) != 0)
+                return 1;
+            break;
+        case 'O':
+            //! natural, shuffled or both
+            orders.count = (strcmp(optarg, "both") == 0) ? 2 : 1;
+            orders.values[0] = (strcmp(optarg, "shuffled") == 0) ? 1 : 0;
+            break;
+        case 'f':
+            file = optarg;
+            break;
+        case 'k':
+            O.products = atoi(optarg);
+            break;
+        case 'r':
+            O.repetitions = atoi(optarg);
+            break;
+        case 'w':
+            O.warmup = atoi(optarg);
+            break;
+        case 'c':
+            O.cache_kb = atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if (orders.count == 2)
+    {
+        orders.values[0] = 0;
+        orders.values[1] = 1;
+    }
+    if (O.products < 1)
+        O.products = 1;
+    if (O.repetitions < 1)
+        O.repetitions = 1;
+    if (O.cache_kb * 1024 < LINE_BYTES * WAYS)
+        O.cache_kb = LINE_BYTES * WAYS / 1024 + 1;
+
+    //! A file is one matrix, shuffled with every seed
+    if (file != NULL)
+    {
+        sizes.count = densities.count = graphs.count = 1;
+        sizes.values[0] = densities.values[0] = 0;
+    }
+
+    //! The sequential library runs on one thread whatever is asked
+#ifndef _OPENMP
+    threads.count = 1;
+    threads.values[0] = 1;
+#endif
+
+    int total = graphs.count * sizes.count * densities.count * seeds.count * orders.count * threads.count;
+    if (total == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Result *results = malloc(total * sizeof(Result));
+    double *times = malloc(O.repetitions * sizeof(double));
+    if (results == NULL || times == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for the results failed\n\n");
+        exit(1);
+    }
+
+    int count = 0;
+    for (int a = 0; a < graphs.count; a++)
+        for (int b = 0; b < sizes.count; b++)
+            for (int c = 0; c < densities.count; c++)
+                for (int d = 0; d < seeds.count; d++)
+                {
+                    RCMGraph graph = (RCMGraph)graphs.values[a];
+                    int seed = (int)seeds.values[d];
+
+                    CSR *A = (file != NULL) ? read_matrix(file)
+                                            : generate_graph(graph, (int)sizes.values[b], densities.values[c], seed);
+                    if (A == NULL)
+                        exit(1);
+
+                    for (int e = 0; e < orders.count; e++)
+                    {
+                        //! Meshes rarely come numbered along the grid, so the
+                        //! generated ones are numbered at random, unless asked
+                        CSR *input = A;
+                        if (orders.values[e] == 1)
+                        {
+                            int *shuffle = random_permutation(A->n, seed);
+                            input = permute_csr(A, shuffle, 1);
+                            free(shuffle);
+                            if (input == NULL)
+                                exit(1);
+                        }
+
+                        Result R = {(file != NULL) ? file : rcm_graph_name(graph),
+                                    (orders.values[e] == 1) ? "shuffled" : "natural",
+                                    A->n, (long long)A->nnz, densities.values[c], 0, seed};
+                        measure(input, &R, &threads, &O, times, results, &count);
+
+                        if (input != A)
+                            freeCSR(input);
+                    }
+
+                    freeCSR(A);
+                }
+
+    //! Write the results as JSON if the file name asks for it, else as CSV
+    FILE *fp = stdout;
+    if (output != NULL)
+    {
+        fp = fopen(output, "w");
+        if (fp == NULL)
+        {
+            printf(RED "Error:" RESET_COLOR " Could not open '%s' for writing\n\n", output);
+            return 1;
+        }
+    }
+
+    size_t len = (output != NULL) ? strlen(output) : 0;
+    if (len >= 5 && strcmp(output + len - 5, ".json") == 0)
+        write_json(fp, results, count, &O);
+    else
+        write_csv(fp, results, count, &O);
+
+    if (fp != stdout)
+        fclose(fp);
+
+    free(results);
+    free(times);
+
+    return 0;
+}
+
+void usage(const char *name)
+{
+    printf("Usage: %s [-g graphs] [-n sizes] [-d densities] [-s seeds] [-t threads]\n"
+           "          [-O natural|shuffled|both] [-f matrix_file] [-k products] [-r repetitions]\n"
+           "          [-w warmup] [-c cache_kb] [-o file.csv|file.json]\n\n"
+           "Lists are comma separated, e.g. -g grid2d,powerlaw -n 100000,1000000 -t 1,2,4\n",
+           name);
+}
+
+const char *engine_name(void)
+{
+#ifdef _OPENMP
+    if (rcm_get_engine() == RCM_ENGINE_LEVELS)
+        return "levels";
+    if (rcm_get_engine() == RCM_ENGINE_COMPONENTS)
+        return "components";
+#endif
+
+    return "queue";
+}
+
+const char *backend_name(void)
+{
+#ifdef _OPENMP
+    if (rcm_get_backend() == RCM_BACKEND_SEQUENTIAL)
+        return "sequential";
+#endif
+
+    return LIBRARY;
+}
+
+void parse_list(const char *str, List *list)
+{
+    list->count = 0;
+
+    const char *p = str;
+    while (*p != '\0' && list->count < MAX_VALUES)
+    {
+        char *end;
+        double value = strtod(p, &end);
+        if (end == p)
+            break;
+
+        list->values[list->count++] = value;
+        p = (*end == ',') ? end + 1 : end;
+    }
+}
+
+//! A comma separated list of graph families, by name
+int parse_graphs(const char *str, List *list)
+{
+    char names[256];
+    snprintf(names, sizeof(names), "%s", str);
+
+    list->count = 0;
+    for (char *name = strtok(names, ","); name != NULL && list->count < MAX_VALUES; name = strtok(NULL, ","))
+    {
+        int graph = rcm_graph_from_name(name);
+        if (graph < 0)
+        {
+            printf(RED "Error:" RESET_COLOR " Unknown graph '%s'\n\n", name);
+            return -1;
+        }
+        list->values[list->count++] = graph;
+    }
+
+    return 0;
+}
+
+//! Fisher-Yates shuffle, with the 64-bit generator of SplitMix64
+int *random_permutation(int n, uint64_t seed)
+{
+    int *permutation = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (permutation == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for 'permutation' failed\n\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < n; i++)
+        permutation[i] = i;
+
+    uint64_t state = seed;
+    for (int i = n - 1; i > 0; i--)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+
+        int j = (int)(z % (uint64_t)(i + 1));
+        int tmp = permutation[i];
+        permutation[i] = permutation[j];
+        permutation[j] = tmp;
+    }
+
+    return permutation;
+}
+
+//! An array of ones, first touched by the threads that will read it
+double *ones(RCMOffset count)
+{
+    double *values = malloc((count > 0 ? count : 1) * sizeof(double));
+    if (values == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for the vectors failed\n\n");
+        exit(1);
+    }
+
+#pragma omp parallel for schedule(static)
+    for (RCMOffset k = 0; k < count; k++)
+        values[k] = 1;
+
+    return values;
+}
+
+//! y = A x, one block of rows per thread
+void spmv(CSR *A, const double *values, const double *x, double *y)
+{
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < A->n; i++)
+    {
+        double sum = 0;
+        for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+            sum += values[k] * x[A->col_idx[k]];
+        y[i] = sum;
+    }
+}
+
+//! Median seconds per product, each sample timing O->products of them
+double time_spmv(CSR *A, Options *O, double *times)
+{
+    double *values = ones(A->nnz);
+    double *x = ones(A->n);
+    double *y = ones(A->n);
+    struct timespec start, end;
+
+    for (int r = 0; r < O->warmup; r++)
+        spmv(A, values, x, y);
+
+    for (int r = 0; r < O->repetitions; r++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int k = 0; k < O->products; k++)
+            spmv(A, values, k % 2 ? y : x, k % 2 ? x : y);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        times[r] = seconds(&start, &end) / O->products;
+    }
+
+    free(values);
+    free(x);
+    free(y);
+
+    return median(times, O->repetitions);
+}
+
+//! Median seconds to find the ordering and apply it, as a solver would
+double time_reorder(CSR *A, Options *O, double *times)
+{
+    struct timespec start, end;
+
+    for (int r = 0; r < O->repetitions; r++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int *permutation = rcm_csr(A->row_ptr, A->col_idx, A->n);
+        CSR *B = (permutation != NULL) ? permute_csr(A, permutation, 1) : NULL;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (B == NULL)
+            exit(1);
+        free(permutation);
+        freeCSR(B);
+
+        times[r] = seconds(&start, &end);
+    }
+
+    return median(times, O->repetitions);
+}
+
+//! Mean number of distinct cache lines of x each row reads, from the
+//! sorted columns. Narrow rows read few, each one of them fully used
+double x_lines_per_row(CSR *A)
+{
+    int per_line = LINE_BYTES / sizeof(double);
+    long long lines = 0;
+
+#pragma omp parallel for schedule(static) reduction(+ : lines)
+    for (int i = 0; i < A->n; i++)
+        for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+            if (k == A->row_ptr[i] || A->col_idx[k] / per_line != A->col_idx[k - 1] / per_line)
+                lines++;
+
+    return (A->n > 0) ? (double)lines / A->n : 0;
+}
+
+/*
+*************************************************************************
+*    Miss rate of the reads of x, as one thread reads them row by row,  *
+*    in a WAYS-way set-associative LRU cache of cache_kb KB with        *
+*    LINE_BYTES lines. The matrix itself is streamed the same way       *
+*    whatever the order, so x is what the ordering changes: a cache     *
+*    miss proxy that needs no hardware counters                         *
+*************************************************************************
+*/
+
+double x_miss_rate(CSR *A, int cache_kb)
+{
+    int per_line = LINE_BYTES / sizeof(double);
+    int sets = cache_kb * 1024 / (LINE_BYTES * WAYS);
+
+    long long *tags = malloc((size_t)sets * WAYS * sizeof(long long));
+    long long *used = calloc((size_t)sets * WAYS, sizeof(long long));
+    if (tags == NULL || used == NULL)
+    {
+        printf(RED "Error:" RESET_COLOR " Memory allocation for the cache failed\n\n");
+        exit(1);
+    }
+    for (size_t w = 0; w < (size_t)sets * WAYS; w++)
+        tags[w] = -1;
+
+    long long misses = 0, clock = 0;
+    for (int i = 0; i < A->n; i++)
+        for (RCMOffset k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+        {
+            long long line = A->col_idx[k] / per_line;
+            long long *tag = tags + (line % sets) * WAYS;
+            long long *last = used + (line % sets) * WAYS;
+
+            //! A hit, or else the least recently used way is replaced
+            int way = 0;
+            for (int w = 0; w < WAYS; w++)
+            {
+                if (tag[w] == line)
+                {
+                    way = w;
+                    break;
+                }
+                if (last[w] < last[way])
+                    way = w;
+            }
+            if (tag[way] != line)
+            {
+                tag[way] = line;
+                misses++;
+            }
+            last[way] = ++clock;
+        }
+
+    free(tags);
+    free(used);
+
+    return (clock > 0) ? (double)misses / clock : 0;
+}
+
+double seconds(struct timespec *start, struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1.0e9;
+}
+
+double median(double *times, int count)
+{
+    qsort(times, count, sizeof(double), compare_double);
+
+    return (count % 2) ? times[count / 2] : (times[count / 2 - 1] + times[count / 2]) / 2;
+}
+
+int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+*************************************************************************
+*    Everything about one matrix: the proxies, which do not depend on   *
+*    the threads, once, and then the products and the reordering at     *
+*    every thread count. The reordering pays off after break_even       *
+*    products, the cost of it over what each one saves                  *
+*************************************************************************
+*/
+
+void measure(CSR *A, Result *R, List *threads, Options *O, double *times, Result *results, int *count)
+{
+    int *permutation = rcm_csr(A->row_ptr, A->col_idx, A->n);
+    CSR *B = (permutation != NULL) ? permute_csr(A, permutation, 1) : NULL;
+    if (B == NULL)
+        exit(1);
+    free(permutation);
+
+    CSR *matrices[2] = {A, B};
+    for (int m = 0; m < 2; m++)
+    {
+        Metrics metrics;
+        if (calc_metrics_csr(matrices[m]->row_ptr, matrices[m]->col_idx, matrices[m]->n, NULL, &metrics) != 0)
+            exit(1);
+        R->bandwidth[m] = metrics.bandwidth;
+        R->x_lines[m] = x_lines_per_row(matrices[m]);
+        R->miss_rate[m] = x_miss_rate(matrices[m], O->cache_kb);
+    }
+
+    for (int t = 0; t < threads->count; t++)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads((int)threads->values[t]);
+#endif
+        R->threads = (int)threads->values[t];
+
+        for (int m = 0; m < 2; m++)
+        {
+            R->spmv_time[m] = time_spmv(matrices[m], O, times);
+            R->gflops[m] = (R->spmv_time[m] > 0) ? 2.0 * R->nnz / R->spmv_time[m] / 1.0e9 : 0;
+        }
+        R->reorder_time = time_reorder(A, O, times);
+
+        double saved = R->spmv_time[0] - R->spmv_time[1];
+        R->break_even = (saved > 0) ? (long long)ceil(R->reorder_time / saved) : -1;
+
+        results[(*count)++] = *R;
+
+        fprintf(stderr, "%s %s %s n=%d threads=%d: %.3f -> %.3f GFLOP/s, ", LIBRARY, R->graph, R->order, R->n,
+                R->threads, R->gflops[0], R->gflops[1]);
+        if (R->break_even < 0)
+            fprintf(stderr, "reordering never pays off\n");
+        else
+            fprintf(stderr, "reordering pays off after %lld products\n", R->break_even);
+    }
+
+    freeCSR(B);
+}
+
+void write_csv(FILE *fp, Result *results, int count, Options *O)
+{
+    fprintf(fp, "library,backend,ordering,engine,graph,order,n,nnz,density,seed,threads,products,repetitions,cache_kb,"
+                "bandwidth_before,bandwidth_after,x_lines_before,x_lines_after,miss_rate_before,miss_rate_after,"
+                "spmv_before,spmv_after,gflops_before,gflops_after,reorder,break_even\n");
+    for (int k = 0; k < count; k++)
+    {
+        Result *R = &results[k];
+        fprintf(fp, "%s,%s,%s,%s,%s,%s,%d,%lld,%g,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.6f,%.6f,%.9f,%.9f,%.3f,%.3f,%.9f,%lld\n",
+                LIBRARY, backend_name(), rcm_ordering_name(rcm_get_ordering()), engine_name(), R->graph, R->order, R->n, R->nnz, R->density, R->seed, R->threads,
+                O->products, O->repetitions, O->cache_kb, R->bandwidth[0], R->bandwidth[1], R->x_lines[0], R->x_lines[1],
+                R->miss_rate[0], R->miss_rate[1], R->spmv_time[0], R->spmv_time[1], R->gflops[0], R->gflops[1],
+                R->reorder_time, R->break_even);
+    }
+}
+
+void write_json(FILE *fp, Result *results, int count, Options *O)
+{
+    fprintf(fp, "{\n  \"library\": \"%s\",\n  \"backend\": \"%s\",\n", LIBRARY, backend_name());
+    fprintf(fp, "  \"ordering\": \"%s\",\n  \"engine\": \"%s\",\n", rcm_ordering_name(rcm_get_ordering()), engine_name());
+    fprintf(fp, "  \"products\": %d,\n  \"repetitions\": %d,\n  \"cache_kb\": %d,\n  \"results\": [\n",
+            O->products, O->repetitions, O->cache_kb);
+    for (int k = 0; k < count; k++)
+    {
+        Result *R = &results[k];
+        fprintf(fp, "    {\"graph\": \"%s\", \"order\": \"%s\", \"n\": %d, \"nnz\": %lld, \"density\": %g, \"seed\": %d, "
+                    "\"threads\": %d, \"bandwidth\": [%d, %d], \"x_lines\": [%.3f, %.3f], \"miss_rate\": [%.6f, %.6f], "
+                    "\"spmv\": [%.9f, %.9f], \"gflops\": [%.3f, %.3f], \"reorder\": %.9f, \"break_even\": %lld}%s\n",
+                R->graph, R->order, R->n, R->nnz, R->density, R->seed, R->threads, R->bandwidth[0], R->bandwidth[1],
+                R->x_lines[0], R->x_lines[1], R->miss_rate[0], R->miss_rate[1], R->spmv_time[0], R->spmv_time[1],
+                R->gflops[0], R->gflops[1], R->reorder_time, R->break_even, (k < count - 1) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+}